@@ -0,0 +1,251 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sys/resource.h>
+#include "../language/Lexer.hpp"
+
+// Every allocation made while a corpus is lexed is counted here.
+static std::atomic<uint64_t> allocation_count = 0;
+
+void* operator new(size_t size)
+{
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+	if (void* p = std::malloc(size ? size : 1)) return p;
+
+	std::abort();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+struct Corpus
+{
+	std::string name;
+	std::string text;
+};
+
+struct LexerBenchmark
+{
+	// Appends 'make(i)' until the text reaches 'size' bytes.
+	template<typename F>
+	static std::string Repeat(size_t size, F make)
+	{
+		std::string res;
+		res.reserve(size + 256);
+
+		for (int i = 0; res.size() < size; i++) {
+			res += make(i);
+		}
+
+		return res;
+	}
+
+	static std::string Identifiers(size_t size)
+	{
+		return Repeat(size, [](int i) {
+			std::string n = std::to_string(i);
+			return "\tcom value_" + n + ": i32 = other_identifier_" + n + ";\n\tvalue_" + n + " += counter_" + n + ";\n";
+		});
+	}
+
+	static std::string Comments(size_t size)
+	{
+		return Repeat(size, [](int i) {
+			return "# Comment line " + std::to_string(i) + ", long enough to take the fast path of the scanner.\n"
+				"\t# An indented comment, then a single statement so there are tokens to count.\n"
+				"\tx += 1;\n";
+		});
+	}
+
+	static std::string Literals(size_t size)
+	{
+		return Repeat(size, [](int i) {
+			std::string n = std::to_string(i);
+			return "\tx = 1_000_" + n + "; y = 0x" + n + "FF; z = 0b1010_" + std::string(n.size(), '1') +
+				"; c = 'a'; s = \"string number " + n + " with an \\\"escape\\\"\";\n";
+		});
+	}
+
+	static std::string Nested(size_t size)
+	{
+		return Repeat(size, [](int i) {
+			const int depth = 16;
+			std::string res;
+
+			for (int d = 0; d < depth; d++) {
+				res += std::string(d + 1, '\t') + (d % 2 ? "while" : "if") + " COMPARE.IsLessThan(x, " + std::to_string(i + d) + ") " + (d % 2 ? "do" : "then") + "\n";
+			}
+
+			res += std::string(depth + 1, '\t') + "x += 1;\n";
+
+			for (int d = depth - 1; d >= 0; d--) {
+				res += std::string(d + 1, '\t') + "end;\n";
+			}
+
+			return res;
+		});
+	}
+
+	// Many small procedures, each calling the previous one, and a program
+	// that calls the last: a valid input for timing 'mascal build' as well.
+	static std::string Procedures(size_t size)
+	{
+		int count = 0;
+
+		std::string res = Repeat(size, [&count](int i) {
+			std::string n = std::to_string(i);
+			std::string call = i == 0 ? "a" : "step_" + std::to_string(i - 1) + "(a)";
+			count = i + 1;
+			return "proc step_" + n + "(com a: i32): i32 begin\n\tcom b: i32 = " + call + ";\n\tb += 1;\n\treturn b;\nend\n\n";
+		});
+
+		return res + "program begin\n\tcom x: i32 = 0;\n\tcom y: i32 = step_" + std::to_string(count - 1) + "(x);\n\treturn y;\nend\n";
+	}
+
+	static std::vector<Corpus> Generate(size_t size)
+	{
+		return {
+			{ "identifiers", Identifiers(size) },
+			{ "comments", Comments(size) },
+			{ "literals", Literals(size) },
+			{ "nested", Nested(size) },
+			{ "procedures", Procedures(size) },
+		};
+	}
+
+	// Lexes the corpus to EOF 'iterations' times and prints one JSON object
+	// with the fastest run.
+	static void Run(const Corpus& corpus, int iterations, bool last)
+	{
+		Lexer lexer;
+		lexer.AddContent(corpus.text);
+
+		double best = 0;
+		uint64_t tokens = 0;
+		uint64_t allocations = 0;
+
+		for (int it = 0; it < iterations; it++) {
+
+			uint64_t count = 0;
+			uint64_t allocationsBefore = allocation_count.load();
+			auto begin = std::chrono::steady_clock::now();
+
+			lexer.Start();
+
+			do {
+				lexer.GetNextToken();
+				count++;
+			} while (lexer.CurrentToken != Token::EndOfFile);
+
+			auto end = std::chrono::steady_clock::now();
+			double seconds = std::chrono::duration<double>(end - begin).count();
+
+			if (it == 0 || seconds < best) {
+				best = seconds;
+				allocations = allocation_count.load() - allocationsBefore;
+			}
+
+			tokens = count;
+		}
+
+		double megabytes = corpus.text.size() / (1024.0 * 1024.0);
+
+		std::cout << "\t\t{ \"corpus\": \"" << corpus.name << "\""
+			<< ", \"bytes\": " << corpus.text.size()
+			<< ", \"tokens\": " << tokens
+			<< ", \"seconds\": " << best
+			<< ", \"mb_per_second\": " << megabytes / best
+			<< ", \"tokens_per_second\": " << tokens / best
+			<< ", \"allocations_per_token\": " << (double)allocations / tokens
+			<< " }" << (last ? "" : ",") << "\n";
+	}
+
+	// Peak resident memory of the process so far, in kilobytes.
+	static long PeakMemory()
+	{
+		rusage usage {};
+		getrusage(RUSAGE_SELF, &usage);
+
+		return usage.ru_maxrss;
+	}
+
+	// Tokenizes one file the way 'mascal build' does and prints the peak
+	// memory of the process. Nothing else is loaded, so it's what lexing
+	// the file costs: the mapped source, the tokens and the interned names.
+	static int Measure(const std::string& path)
+	{
+		long before = PeakMemory();
+		auto begin = std::chrono::steady_clock::now();
+
+		Lexer lexer;
+
+		if (!lexer.OpenFile(path)) {
+			std::cout << "Could not open '" << path << "'.\n";
+			return 1;
+		}
+
+		lexer.Tokenize();
+
+		auto end = std::chrono::steady_clock::now();
+
+		std::cout << "{ \"file\": \"" << path << "\""
+			<< ", \"tokens\": " << lexer.Tokens.Size()
+			<< ", \"seconds\": " << std::chrono::duration<double>(end - begin).count()
+			<< ", \"peak_kb\": " << PeakMemory()
+			<< ", \"peak_kb_before\": " << before
+			<< " }\n";
+
+		return 0;
+	}
+};
+
+int main(int argc, char** argv)
+{
+	size_t size = 16 * 1024 * 1024;
+	int iterations = 5;
+	std::string writeDir;
+	std::string measurePath;
+
+	for (int i = 1; i < argc; i++) {
+
+		std::string arg = argv[i];
+
+		if (arg == "--size" && i + 1 < argc) size = std::stoul(argv[++i]) * 1024 * 1024;
+		else if (arg == "--iterations" && i + 1 < argc) iterations = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "--write" && i + 1 < argc) writeDir = argv[++i];
+		else if (arg == "--measure" && i + 1 < argc) measurePath = argv[++i];
+		else {
+			std::cout << "Usage: lexer_benchmark [--size MB] [--iterations N] [--write DIR]\n"
+				"       lexer_benchmark --measure FILE\n";
+			return 1;
+		}
+	}
+
+	// Peak memory is per process, so a file is measured on its own.
+	if (measurePath != "") return LexerBenchmark::Measure(measurePath);
+
+	std::vector<Corpus> corpora = LexerBenchmark::Generate(size);
+
+	// The corpora can be written out to feed them to 'mascal build' as well.
+	if (writeDir != "") {
+		for (auto const& c : corpora) {
+			std::ofstream(writeDir + "/" + c.name + ".mascal", std::ios::binary) << c.text;
+		}
+	}
+
+	std::cout << "{\n\t\"iterations\": " << iterations << ",\n\t\"results\": [\n";
+
+	for (size_t i = 0; i < corpora.size(); i++) {
+		LexerBenchmark::Run(corpora[i], iterations, i + 1 == corpora.size());
+	}
+
+	std::cout << "\t]\n}\n";
+
+	return 0;
+}
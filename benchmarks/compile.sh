@@ -0,0 +1,4 @@
+#!/bin/bash
+
+# Run from the repository root: ./benchmarks/compile.sh && ./lexer_benchmark
+clang++ -O3 benchmarks/LexerBenchmark.cpp language/Lexer.cpp language/Symbols.cpp `llvm-config --cxxflags --ldflags --system-libs --libs support` -fno-rtti -std=c++20 -o lexer_benchmark
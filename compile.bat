@@ -15,7 +15,7 @@ set MTCPPAssembly=translators/Assembly/*.cpp
 set MTCPPx86Assembly=translators/Assembly/X86/*.cpp
 
 echo Compiling Mascal on Windows...
-%ClangPath% -g -O3 %MTCPPAssembly% %MTCPPx86Assembly% language/*.cpp *.cpp %LLVMConfigResult% -fstack-protector -lssp -frtti -std=c++20 -static -o mascal
+%ClangPath% -g -O3 %MTCPPAssembly% %MTCPPx86Assembly% language/*.cpp *.cpp %LLVMConfigResult% -fstack-protector -lssp -fno-rtti -std=c++20 -static -o mascal
 
 IF "%ERRORLEVEL%"=="0" (
     echo Mascal Compiled Successfully!
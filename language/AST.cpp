@@ -3,6 +3,24 @@
 
 int AST::slash_t_count = 0;
 
+thread_local AST::Arena* AST::arena = nullptr;
+std::deque<AST::Arena> AST::arenas;
+std::mutex AST::arenas_lock;
+
+void AST::ReleaseArena() {
+
+	std::lock_guard<std::mutex> guard(arenas_lock);
+
+	for(auto& i : arenas) {
+		for(IntNumber* n : i.literals) {
+			n->~IntNumber();
+		}
+	}
+
+	arenas.clear();
+	arena = nullptr;
+}
+
 llvm::Function* AST::Program::codegen() {
 
 	std::vector<llvm::Type*> llvmArgs;
@@ -20,8 +38,6 @@ llvm::Function* AST::Program::codegen() {
 		all_instructions[i]->codegen();
 	}
 
-	CodeGen::UpdateAllPHIPreds();
-
 	// mustprogress nofree norecurse nosync nounwind readnone willreturn
 
 	F->addFnAttr(llvm::Attribute::MustProgress);
@@ -36,8 +52,6 @@ llvm::Function* AST::Program::codegen() {
 	F->addFnAttr(llvm::Attribute::ReadNone);
 	F->addFnAttr(llvm::Attribute::WillReturn);
 
-	F->setCallingConv(llvm::CallingConv::GHC);
-
 	return F;
 }
 
@@ -52,13 +66,96 @@ llvm::Type* AST::Void::codegen() { return llvm::IntegerType::getVoidTy(*CodeGen:
 
 llvm::Value* AST::RetVoid::codegen() { return nullptr; }
 
-llvm::Value* AST::ProcedureCall::codegen() {
+llvm::Function* AST::Procedure::Declare() {
+
+	if(llvm::Function* F = CodeGen::TheModule->getFunction(Symbols::Name(procName))) {
+		return F;
+	}
+
+	std::vector<llvm::Type*> llvmArgs;
+
+	for(auto const& i : all_argument_types) {
+		llvmArgs.push_back(i->codegen());
+	}
+
+	llvm::FunctionType* FT = llvm::FunctionType::get(proc_type->codegen(), llvmArgs, false);
+
+	// Internal, so the inliner is free to drop it once every call is inlined.
+	return llvm::Function::Create(FT, llvm::Function::InternalLinkage, Symbols::Name(procName), CodeGen::TheModule.get());
+}
+
+llvm::Function* AST::Procedure::codegen() {
+
+	llvm::Function* F = Declare();
+
+	// A procedure has its own coms, mems and blocks. The ones of whatever
+	// was being generated before are put back when it's done.
+	llvm::IRBuilderBase::InsertPointGuard guard(*CodeGen::Builder);
+
+	llvm::MapVector<Symbol, std::unique_ptr<LLVM_Com>> outer_coms;
+	llvm::MapVector<Symbol, std::unique_ptr<LLVM_Mem>> outer_mems;
+	llvm::DenseMap<llvm::BasicBlock*, llvm::MapVector<Symbol, llvm::PHINode*>> outer_unsealed_blocks;
+
+	std::swap(outer_coms, CodeGen::all_coms);
+	std::swap(outer_mems, CodeGen::all_mems);
+	std::swap(outer_unsealed_blocks, CodeGen::unsealed_blocks);
+
+	llvm::BasicBlock* BB = llvm::BasicBlock::Create(*CodeGen::TheContext, "entry", F);
+
+	CodeGen::Builder->SetInsertPoint(BB);
+
+	int Idx = 0;
+	for(auto& arg : F->args()) {
+
+		Symbol argName = all_arguments[Idx]->name;
+
+		arg.setName(Symbols::Name(argName));
+
+		std::unique_ptr<LLVM_Com> lcom = std::make_unique<LLVM_Com>();
+		lcom->origin = &arg;
+		lcom->ty = arg.getType();
+		lcom->states[BB] = &arg;
+
+		CodeGen::all_coms[argName] = std::move(lcom);
+
+		Idx++;
+	}
 
 	for(auto const& i: body) {
 		i->codegen();
 	}
 
-	return return_obj->codegen();
+	if(returnName != Symbols::None) {
+		CodeGen::Builder->CreateRet(AST::GetCurrentInstructionByName(returnName));
+	}
+	else {
+		CodeGen::Builder->CreateRetVoid();
+	}
+
+	std::swap(outer_coms, CodeGen::all_coms);
+	std::swap(outer_mems, CodeGen::all_mems);
+	std::swap(outer_unsealed_blocks, CodeGen::unsealed_blocks);
+
+	return F;
+}
+
+llvm::Value* AST::Call::codegen() {
+
+	llvm::Function* F = CodeGen::TheModule->getFunction(Symbols::Name(callee));
+
+	if(F == nullptr) {
+
+		std::cout << "Unknown procedure '" << Symbols::Name(callee) << "'\n";
+		exit(1);
+	}
+
+	std::vector<llvm::Value*> args;
+
+	for(auto const& i : arguments) {
+		args.push_back(AST::GetOrCreateInstruction(i.get()));
+	}
+
+	return CodeGen::Builder->CreateCall(F, args);
 }
 
 llvm::Value* AST::IntNumber::codegen() {
@@ -74,7 +171,7 @@ llvm::Value* AST::IntNumber::codegen() {
 		exit(1);
 	}
 
-	return llvm::ConstantInt::get(*CodeGen::TheContext, llvm::APInt(int_ty->getBitWidth(), num, true));
+	return llvm::ConstantInt::get(*CodeGen::TheContext, num.sextOrTrunc(int_ty->getBitWidth()));
 }
 
 llvm::Value* AST::Variable::codegen() {
@@ -87,7 +184,7 @@ llvm::Value* AST::Variable::codegen() {
 
 	if(result == nullptr) {
 
-		std::cout << "Unknown variable '" << name << "'\n";
+		std::cout << "Unknown variable '" << Symbols::Name(name) << "'\n";
 		exit(1);
 	}
 
@@ -100,7 +197,8 @@ llvm::Value* AST::Com::codegen() {
 
 	std::unique_ptr<LLVM_Com> lcom = std::make_unique<LLVM_Com>();
 	lcom->origin = tc;
-	lcom->current = tc;
+	lcom->ty = tc->getType();
+	lcom->states[CodeGen::Builder->GetInsertBlock()] = tc;
 
 	CodeGen::all_coms[name] = std::move(lcom);
 
@@ -115,7 +213,7 @@ llvm::Value* AST::Mem::codegen() {
 
 	llvm::Type* get_type = ty->codegen();
 
-	llvm::Value* alloc_origin = CodeGen::Builder->CreateAlloca(get_type, 0, name);
+	llvm::Value* alloc_origin = CodeGen::Builder->CreateAlloca(get_type, 0, Symbols::Name(name));
 	lmem->origin = alloc_origin;
 
 	llvm::Value* store_target = CodeGen::Builder->CreateStore(tc, lmem->origin);
@@ -157,7 +255,7 @@ llvm::Value* AST::IntCast::codegen() {
 	llvm::Value* targetC = AST::GetOrCreateInstruction(target.get());
 	llvm::Type* typeC = intType->codegen();
 
-	return CodeGen::Builder->CreateIntCast(targetC, typeC, true, target->name);
+	return CodeGen::Builder->CreateIntCast(targetC, typeC, true, Symbols::Name(target->name));
 }
 
 llvm::Value* AST::ComStore::codegen() {
@@ -171,8 +269,10 @@ llvm::Value* AST::ComStore::codegen() {
 
 llvm::Value* AST::GetAllocaFromMem(AST::Expression* e) {
 
-	if(CodeGen::all_mems.find(e->name) != CodeGen::all_mems.end()) {
-		return CodeGen::all_mems[e->name]->origin;
+	auto found = CodeGen::all_mems.find(e->name);
+
+	if(found != CodeGen::all_mems.end()) {
+		return found->second->origin;
 	}
 
 	return nullptr;
@@ -201,7 +301,25 @@ llvm::Value* AST::LoadMem::codegen() {
 		exit(1);
 	}
 
-	return CodeGen::Builder->CreateLoad(CodeGen::all_mems[target->name]->ty, mem_alloca, target->name);
+	return CodeGen::Builder->CreateLoad(CodeGen::all_mems[target->name]->ty, mem_alloca, Symbols::Name(target->name));
+}
+
+llvm::Value* AST::Binary::codegen() {
+
+	llvm::Value* L = AST::GetOrCreateInstruction(left.get());
+	llvm::Value* R = AST::GetOrCreateInstruction(right.get());
+
+	if(op == AST::BinaryType::Plus) { return CodeGen::Builder->CreateAdd(L, R); }
+	if(op == AST::BinaryType::Minus) { return CodeGen::Builder->CreateSub(L, R); }
+	if(op == AST::BinaryType::Times) { return CodeGen::Builder->CreateMul(L, R); }
+	if(op == AST::BinaryType::Divide) { return CodeGen::Builder->CreateSDiv(L, R); }
+	if(op == AST::BinaryType::Remainder) { return CodeGen::Builder->CreateSRem(L, R); }
+	if(op == AST::BinaryType::ShiftLeft) { return CodeGen::Builder->CreateShl(L, R); }
+	if(op == AST::BinaryType::ShiftRight) { return CodeGen::Builder->CreateAShr(L, R); }
+	if(op == AST::BinaryType::BitAnd) { return CodeGen::Builder->CreateAnd(L, R); }
+	if(op == AST::BinaryType::BitOr) { return CodeGen::Builder->CreateOr(L, R); }
+
+	return CodeGen::Builder->CreateXor(L, R);
 }
 
 llvm::Value* AST::Compare::codegen() {
@@ -221,110 +339,51 @@ llvm::Value* AST::Compare::codegen() {
 	return comp;
 }
 
-bool AST::IsInitializer(AST::Expression* t) {
-
-	return dynamic_cast<AST::Com*>(t) != nullptr || dynamic_cast<AST::Mem*>(t) != nullptr;
-}
-
-bool AST::IsAlgorithm(AST::Expression* t) {
-
-	return dynamic_cast<AST::If*>(t) != nullptr || dynamic_cast<AST::While*>(t) != nullptr;
-}
-
 llvm::Value* AST::While::codegen() {
 
+	for(auto const& i: mem_stores) {
+		i->codegen();
+	}
+
 	llvm::Value* conditionCodegen = AST::GetOrCreateInstruction(condition.get());
 
 	llvm::Function *TheFunction = CodeGen::Builder->GetInsertBlock()->getParent();
 
-	llvm::BasicBlock* EntryBlock = CodeGen::Builder->GetInsertBlock();
 	llvm::BasicBlock* LoopBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "while", TheFunction);
 	llvm::BasicBlock* ContinueBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "continue");
 
 	CodeGen::Builder->CreateCondBr(conditionCodegen, LoopBlock, ContinueBlock);
 
-	CodeGen::Builder->SetInsertPoint(LoopBlock);
-
-	std::unordered_map<std::string, llvm::PHINode*> allPHIs;
+	// The loop jumps back from wherever its body ends, which isn't known
+	// until the body is generated.
+	CodeGen::unsealed_blocks.try_emplace(LoopBlock);
 
-	AST::GlobalSaveState(EntryBlock);
-	AST::GlobalSaveState(LoopBlock);
+	CodeGen::Builder->SetInsertPoint(LoopBlock);
 
 	for(auto const& i: loop_body) {
-
-		AST::SaveState(i->name, EntryBlock);
-
-		bool isNotAVar = AST::IsInitializer(i.get()) || AST::IsAlgorithm(i.get());
-
-		if(!isNotAVar) {
-
-			if(allPHIs.find(i->name) == allPHIs.end()) {
-
-				llvm::BasicBlock* currentBlock = CodeGen::Builder->GetInsertBlock();
-				
-				CodeGen::Builder->SetInsertPoint(LoopBlock, LoopBlock->begin());
-	
-				auto entry = AST::FindExistingState(i->name, EntryBlock);
-	
-				auto phi = CodeGen::Builder->CreatePHI(entry->getType(), 2, "phi");
-	
-				phi->addIncoming(entry, LoopBlock);
-				phi->addIncoming(entry, EntryBlock);
-
-				CodeGen::AddPHINodeToVec(phi);
-
-				allPHIs[i->name] = phi;
-	
-				CodeGen::Builder->SetInsertPoint(currentBlock);
-	
-				AST::AddInstruction(i.get(), allPHIs[i->name]);
-			}
-		}
-
-		auto t = i->codegen();
-
-		if(!isNotAVar) {
-			if(allPHIs.find(i->name) != allPHIs.end()) {
-				allPHIs[i->name]->setIncomingValue(0, t);
-			}
-		}
+		i->codegen();
 	}
 
 	CodeGen::Builder->CreateCondBr(condition->codegen(), LoopBlock, ContinueBlock);
 
+	AST::SealBlock(LoopBlock);
+
 	TheFunction->getBasicBlockList().push_back(ContinueBlock);
 	CodeGen::Builder->SetInsertPoint(ContinueBlock);
 
-	UNORDERED_MAP_FOREACH(std::string, llvm::PHINode*, allPHIs, it) {
-
-		auto firstVal = it->second->getIncomingValue(0);
-		auto secondVal = it->second->getIncomingValue(1);
-
-		auto finalPHI = CodeGen::Builder->CreatePHI(firstVal->getType(), 2, "phi");
-
-		finalPHI->addIncoming(firstVal, LoopBlock);
-		finalPHI->addIncoming(secondVal, EntryBlock);
-
-		CodeGen::AddPHINodeToVec(finalPHI);
-
-		AST::AddInstructionToName(it->first, finalPHI);
-	}
-
-	for(auto const& i: loop_body) {
-		AST::SaveState(i->name, ContinueBlock);
-	}
-
 	return nullptr;
 }
 
 llvm::Value* AST::If::codegen() {
 
+	for(auto const& i: mem_stores) {
+		i->codegen();
+	}
+
 	llvm::Value* conditionCodegen = AST::GetOrCreateInstruction(condition.get());
 
 	llvm::Function *TheFunction = CodeGen::Builder->GetInsertBlock()->getParent();
 
-	llvm::BasicBlock* EntryBlock = CodeGen::Builder->GetInsertBlock();
-
 	llvm::BasicBlock* IfBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "if", TheFunction);
 	llvm::BasicBlock* ElseBlock = nullptr;
 	llvm::BasicBlock* ContinueBlock = llvm::BasicBlock::Create(*CodeGen::TheContext, "continue");
@@ -339,30 +398,10 @@ llvm::Value* AST::If::codegen() {
 
 	CodeGen::Builder->SetInsertPoint(IfBlock);
 
-	llvm::BasicBlock* finalEntryBlock = nullptr;
-
-	if(parent_entry_block != nullptr) {
-		finalEntryBlock = parent_entry_block;
-	}
-	else {
-		finalEntryBlock = EntryBlock;
-	}
-
 	for(auto const& i: if_body) {
-
-		AST::SaveState(i->name, EntryBlock);
-
-		if(parent_entry_block != nullptr) {
-			AST::SetExistingState(i->name, finalEntryBlock);
-		}
-
 		i->codegen();
 	}
 
-	for(auto const& i: if_body) {
-		AST::SaveState(i->name, IfBlock);
-	}
-
 	CodeGen::Builder->CreateBr(ContinueBlock);
 
 	if(else_body.size() != 0) {
@@ -371,30 +410,17 @@ llvm::Value* AST::If::codegen() {
 		CodeGen::Builder->SetInsertPoint(ElseBlock);
 
 		for(auto const& i: else_body) {
-
-			AST::SetExistingState(i->name, finalEntryBlock);
-
-			i->parent_entry_block = finalEntryBlock;
-
 			i->codegen();
 		}
 	
-		for(auto const& i: else_body) {
-			AST::SaveState(i->name, ElseBlock);
-		}
-	
 		CodeGen::Builder->CreateBr(ContinueBlock);
 	}
 
+	// Both ways are done, a com that differs between them gets its PHI
+	// the first time it's read.
 	TheFunction->getBasicBlockList().push_back(ContinueBlock);
 	CodeGen::Builder->SetInsertPoint(ContinueBlock);
 
-	AST::CreateIfPHIs(ContinueBlock);
-
-	for(auto const& i: if_body) {
-		AST::SaveState(i->name, ContinueBlock);
-	}
-
 	return nullptr;
 }
 
@@ -403,59 +429,21 @@ llvm::Value* AST::GetCurrentInstruction(AST::Expression* e) {
 	return AST::GetCurrentInstructionByName(e->name);
 }
 
-llvm::Value* AST::GetCurrentInstructionByName(std::string name) {
+llvm::Value* AST::GetCurrentInstructionByName(Symbol name) {
 
-	llvm::Value* res = nullptr;
+	auto com = CodeGen::all_coms.find(name);
 
-	if(CodeGen::all_coms.find(name) != CodeGen::all_coms.end()) {
-		res = CodeGen::all_coms[name]->current;
+	if(com != CodeGen::all_coms.end()) {
+		return AST::ReadCom(name, com->second.get(), CodeGen::Builder->GetInsertBlock());
 	}
-	else if(CodeGen::all_mems.find(name) != CodeGen::all_mems.end()) {
-		res = CodeGen::all_mems[name]->current;
-	}
-
-	if(res == nullptr) {
-		return res;
-	}
-
-	if(!isa<llvm::PHINode>(res)) {
-		return res;
-	}
-
-	llvm::PHINode* resPHI = dyn_cast<llvm::PHINode>(res);
 
-	llvm::BasicBlock* curBlock = CodeGen::Builder->GetInsertBlock();
-	llvm::BasicBlock* resBlock = resPHI->getParent();
+	auto mem = CodeGen::all_mems.find(name);
 
-	if(resBlock == curBlock) {
-		return res;
+	if(mem != CodeGen::all_mems.end()) {
+		return mem->second->current;
 	}
 
-	std::vector<llvm::BasicBlock*> blockPreds;
-
-	for (auto it = llvm::pred_begin(curBlock), et = llvm::pred_end(curBlock); it != et; ++it)
-	{
-		llvm::BasicBlock* predecessor = *it;
-		blockPreds.push_back(predecessor);
-	}
-
-	auto newPhi = CodeGen::Builder->CreatePHI(res->getType(), 2, "phi");
-
-	auto findState = AST::FindExistingState(name, blockPreds[1]);
-
-	if(findState == nullptr) {
-		std::cout << "There's no '" << name << "' inside the block '" << std::string(blockPreds[1]->getName()) << "'.\n";
-		exit(1);
-	}
-
-	newPhi->addIncoming(res, blockPreds[0]);
-	newPhi->addIncoming(findState, blockPreds[1]);
-
-	CodeGen::AddPHINodeToVec(newPhi);
-
-	AST::AddInstructionToName(name, newPhi);
-
-	return newPhi;
+	return nullptr;
 }
 
 llvm::Value* AST::GetOrCreateInstruction(AST::Expression* e) {
@@ -474,10 +462,12 @@ void AST::AddInstruction(AST::Expression* e, llvm::Value* l) {
 	AST::AddInstructionToName(e->name, l);
 }
 
-void AST::AddInstructionToName(std::string name, llvm::Value* l) {
+void AST::AddInstructionToName(Symbol name, llvm::Value* l) {
+
+	auto com = CodeGen::all_coms.find(name);
 
-	if(CodeGen::all_coms.find(name) != CodeGen::all_coms.end()) {
-		CodeGen::all_coms[name]->current = l;
+	if(com != CodeGen::all_coms.end()) {
+		com->second->states[CodeGen::Builder->GetInsertBlock()] = l;
 	}
 }
 
@@ -486,155 +476,139 @@ llvm::Value* AST::LLReturn::codegen() {
 	return CodeGen::Builder->CreateRet(AST::GetOrCreateInstruction(target.get()));
 }
 
-void AST::GlobalSaveState(llvm::BasicBlock* bb) {
+// Coms are put in SSA form while the code is generated, as in Braun et al.,
+// "Simple and Efficient Construction of Static Single Assignment Form".
+// A block that doesn't assign a com asks its predecessors for the value,
+// and only gets a PHI when they disagree.
+llvm::Value* AST::ReadCom(Symbol name, LLVM_Com* com, llvm::BasicBlock* bb) {
 
-	std::string bbName = std::string(bb->getName());
-	UNORDERED_MAP_FOREACH(std::string, std::unique_ptr<LLVM_Com>, CodeGen::all_coms, it) {
+	auto state = com->states.find(bb);
 
-		AST::SaveState(it->first, bb);
+	if(state != com->states.end() && state->second != nullptr) {
+		return state->second;
 	}
+
+	return AST::ReadComFromPredecessors(name, com, bb);
 }
 
-void AST::SaveState(std::string name, llvm::BasicBlock* bb) {
-	
-	if(name == "" || bb == nullptr) {
-		return;
-	}
+llvm::Value* AST::ReadComFromPredecessors(Symbol name, LLVM_Com* com, llvm::BasicBlock* bb) {
 
-	std::string bbName = std::string(bb->getName());
+	llvm::Value* result = nullptr;
 
-	CodeGen::all_coms[name]->states[bbName] = CodeGen::all_coms[name]->current;
+	auto unsealed = CodeGen::unsealed_blocks.find(bb);
 
-	//std::cout << "Saved '" << name << "' state in '" << bbName << "'.\n";
-}
+	if(unsealed != CodeGen::unsealed_blocks.end()) {
 
-void AST::SetExistingState(std::string name, llvm::BasicBlock* bb) {
+		// Filled in by SealBlock, once every predecessor is known.
+		llvm::PHINode* phi = AST::CreateComPHI(com, bb);
+		unsealed->second[name] = phi;
 
-	if(CodeGen::all_coms.find(name) != CodeGen::all_coms.end()) {
-	
-		std::string bbName = std::string(bb->getName());
-		if(CodeGen::all_coms[name]->states.find(bbName) != CodeGen::all_coms[name]->states.end()) {
+		result = phi;
+	}
+	else if(llvm::BasicBlock* pred = bb->getSinglePredecessor()) {
 
-			CodeGen::all_coms[name]->current = CodeGen::all_coms[name]->states[bbName];
-		}
+		result = AST::ReadCom(name, com, pred);
 	}
-}
+	else if(llvm::pred_empty(bb)) {
 
-llvm::Value* AST::FindExistingState(std::string name, llvm::BasicBlock* bb) {
+		result = llvm::UndefValue::get(com->ty);
+	}
+	else {
 
-	if(CodeGen::all_coms.find(name) != CodeGen::all_coms.end()) {
-	
-		std::string bbName = std::string(bb->getName());
-		if(CodeGen::all_coms[name]->states.find(bbName) != CodeGen::all_coms[name]->states.end()) {
+		// Recorded before the operands are read, so a loop that leads back
+		// here stops at the PHI.
+		llvm::PHINode* phi = AST::CreateComPHI(com, bb);
+		com->states[bb] = phi;
 
-			return CodeGen::all_coms[name]->states[bbName];
-		}
+		result = AST::AddPHIOperands(name, com, phi);
 	}
 
-	return nullptr;
+	com->states[bb] = result;
+
+	return result;
 }
 
-void AST::CreateIfPHIs(llvm::BasicBlock* continueBlock) {
+llvm::PHINode* AST::CreateComPHI(LLVM_Com* com, llvm::BasicBlock* bb) {
 
-	std::vector<llvm::BasicBlock*> blockPreds;
+	if(llvm::Instruction* first = bb->getFirstNonPHI()) {
+		return llvm::PHINode::Create(com->ty, 2, "phi", first);
+	}
+
+	return llvm::PHINode::Create(com->ty, 2, "phi", bb);
+}
 
-	for (auto it = llvm::pred_begin(continueBlock), et = llvm::pred_end(continueBlock); it != et; ++it)
-	{
-		llvm::BasicBlock* predecessor = *it;
+llvm::Value* AST::AddPHIOperands(Symbol name, LLVM_Com* com, llvm::PHINode* phi) {
 
-		blockPreds.push_back(predecessor);
+	for(llvm::BasicBlock* pred : llvm::predecessors(phi->getParent())) {
+		phi->addIncoming(AST::ReadCom(name, com, pred), pred);
 	}
 
-	UNORDERED_MAP_FOREACH(std::string, std::unique_ptr<LLVM_Com>, CodeGen::all_coms, it) {
+	return AST::RemoveTrivialPHI(phi);
+}
 
-		llvm::Value* entryValue = nullptr;
-		llvm::Value* ifValue = nullptr;
-		
-		std::string bbPreds0 = std::string(blockPreds[1]->getName());
+// A PHI that only merges one value with itself is that value. Removing it
+// can make the PHIs that use it trivial as well.
+llvm::Value* AST::RemoveTrivialPHI(llvm::PHINode* phi) {
 
-		if(it->second->states.find(bbPreds0) != it->second->states.end()) {
+	// Still waiting for some of its operands.
+	if(phi->getNumIncomingValues() != llvm::pred_size(phi->getParent())) {
+		return phi;
+	}
 
-			entryValue = it->second->states[bbPreds0];
-	
-			ifValue = it->second->current;
-	
-			auto phi = CodeGen::Builder->CreatePHI(ifValue->getType(), 2, "phi");
-	
-			phi->addIncoming(ifValue, blockPreds[0]);
-			phi->addIncoming(entryValue, blockPreds[1]);
+	llvm::Value* same = nullptr;
 
-			it->second->current = phi;
+	for(llvm::Value* v : phi->incoming_values()) {
 
-			CodeGen::AddPHINodeToVec(phi);
+		if(v == same || v == phi) {
+			continue;
 		}
-	}
-}
-
-void AST::CreateIfElsePHIs(llvm::BasicBlock* continueBlock) {
 
-	std::vector<llvm::BasicBlock*> blockPreds;
+		if(same != nullptr) {
+			return phi;
+		}
 
-	for (auto it = llvm::pred_begin(continueBlock), et = llvm::pred_end(continueBlock); it != et; ++it)
-	{
-		llvm::BasicBlock* predecessor = *it;
-		blockPreds.push_back(predecessor);
+		same = v;
 	}
 
-	UNORDERED_MAP_FOREACH(std::string, std::unique_ptr<LLVM_Com>, CodeGen::all_coms, it) {
-
-		llvm::Value* elseValue = nullptr;
-		llvm::Value* ifValue = nullptr;
+	if(same == nullptr) {
+		same = llvm::UndefValue::get(phi->getType());
+	}
 
-		llvm::BasicBlock* elseBlock = nullptr;
-		llvm::BasicBlock* ifBlock = nullptr;
-		
-		std::string bbPreds0 = std::string(blockPreds[1]->getName());
-		std::string bbPreds1 = std::string(blockPreds[0]->getName());
+	llvm::SmallVector<llvm::WeakVH, 4> users;
 
-		std::string bbPreds2 = std::string(continueBlock->getName());
+	for(llvm::User* u : phi->users()) {
+		if(u != phi && llvm::isa<llvm::PHINode>(u)) {
+			users.push_back(u);
+		}
+	}
 
-		//std::cout << "bbPreds0: " << bbPreds0 << "\n";
-		//std::cout << "bbPreds1: " << bbPreds1 << "\n";
+	phi->replaceAllUsesWith(same);
+	phi->eraseFromParent();
 
-		if(it->second->states.find(bbPreds0) != it->second->states.end()) {
+	// 'same' may itself turn out to be trivial below.
+	llvm::WeakTrackingVH result = same;
 
-			ifValue = it->second->states[bbPreds0];
-			ifBlock = blockPreds[1];
-		}
-		else {
-			//std::cout << "'" << bbPreds0 << "' (bbPreds0) not found!\n";
+	for(auto const& u : users) {
+		if(auto user = llvm::dyn_cast_or_null<llvm::PHINode>(u)) {
+			AST::RemoveTrivialPHI(user);
 		}
+	}
 
-		if(it->second->states.find(bbPreds1) != it->second->states.end()) {
-
-			elseValue = it->second->states[bbPreds1];
-			elseBlock = blockPreds[0];
-	
-			auto phi = CodeGen::Builder->CreatePHI(ifValue->getType(), 2, "phi");
-	
-			phi->addIncoming(elseValue, elseBlock);
-			phi->addIncoming(ifValue, ifBlock);
+	return result;
+}
 
-			it->second->current = phi;
+void AST::SealBlock(llvm::BasicBlock* bb) {
 
-			CodeGen::AddPHINodeToVec(phi);
-		}
-		else if(it->second->states.find(bbPreds2) != it->second->states.end()) {
-			
-			elseValue = it->second->states[bbPreds2];
-			elseBlock = continueBlock;
+	auto unsealed = CodeGen::unsealed_blocks.find(bb);
 
-			auto phi = CodeGen::Builder->CreatePHI(ifValue->getType(), 2, "phi");
-	
-			phi->addIncoming(elseValue, elseBlock);
-			phi->addIncoming(ifValue, ifBlock);
+	if(unsealed == CodeGen::unsealed_blocks.end()) {
+		return;
+	}
 
-			it->second->current = phi;
+	auto waiting = std::move(unsealed->second);
+	CodeGen::unsealed_blocks.erase(unsealed);
 
-			CodeGen::AddPHINodeToVec(phi);
-		}
-		else {
-			//std::cout << "'" << bbPreds1 << "' (bbPreds1) and '" << bbPreds2 << "' (bbPreds2) not found!\n";
-		}
+	for(auto const& i : waiting) {
+		AST::AddPHIOperands(i.first, CodeGen::all_coms[i.first].get(), i.second);
 	}
 }
\ No newline at end of file
@@ -2,121 +2,266 @@
 #define AST_HPP
 
 #include "CodeGen.hpp"
+#include <atomic>
+#include <deque>
+#include <mutex>
 
-#define NEW_TYPE(x, y) struct x : public Type { llvm::Type* codegen() override; std::string ToLLMascal() override { y } std::unique_ptr<Type> Clone() override { return std::make_unique<x>(); } }
+#define NEW_TYPE(x, y, z) struct x : public Type { x() : Type(TK_##x) {} static bool classof(const Type* t) { return t->kind == TK_##x; } llvm::Type* codegen() override; llvm::StringRef ToLLMascal() override { y } unsigned BitWidth() override { return z; } Owned<Type> Clone() override { return New<x>(); } }
 
-#define EXPR_OBJ() std::unique_ptr<Expression>
-#define EXPR_OBJ_VECTOR() std::vector<std::unique_ptr<Expression>>
+#define EXPR_OBJ() Owned<Expression>
+#define EXPR_OBJ_VECTOR() Vector<Owned<Expression>>
 
-#define TYPE_OBJ() std::unique_ptr<Type>
-#define TYPE_OBJ_VECTOR() std::vector<std::unique_ptr<Type>>
+#define TYPE_OBJ() Owned<Type>
+#define TYPE_OBJ_VECTOR() Vector<Owned<Type>>
 
-#define MAP_FOREACH(x, y, z, w) for(std::map<x, y>::iterator w = z.begin(); w != z.end(); ++w)
-#define MAP_FOREACH_PAIR(x, y1, y2, z, w) for(std::map<x, std::pair<y1, y2>>::iterator w = z.begin(); w != z.end(); ++w)
+#define EMPTY_TOLLMASCAL() void ToLLMascal(llvm::raw_ostream& out) override {}
 
-#define UNORDERED_MAP_FOREACH(x, y, z, w) for(std::unordered_map<x, y>::iterator w = z.begin(); w != z.end(); ++w)
-#define UNORDERED_MAP_FOREACH_PAIR(x, y1, y2, z, w) for(std::unordered_map<x, std::pair<y1, y2>>::iterator w = z.begin(); w != z.end(); ++w)
+#define DEFAULT_TOLLMASCALBEFORE() void ToLLMascalBefore(llvm::raw_ostream& out) override {}
 
-#define CLONE_EXPR_VECTOR(x, y) std::vector<std::unique_ptr<AST::Expression>> y; for(auto const& i: x) { auto z = i->Clone(); y.push_back(std::move(z)); }
-#define CLONE_TYPE_VECTOR(x, y) std::vector<std::unique_ptr<AST::Type>> y; for(auto const& i: x) { auto z = i->Clone(); y.push_back(std::move(z)); }
-#define CLONE_AST_CUSTOM_VECTOR(z, x, y) std::vector<std::unique_ptr<z>> y; for(auto const& i: x) { auto z = i->Clone(); y.push_back(std::move(z)); }
+#define EXPR_CLASSOF(x) static bool classof(const Expression* e) { return e->kind == EK_##x; }
 
-#define EMPTY_TOLLMASCAL() std::string ToLLMascal() override { return ""; }
+#define DEFAULT_FOR_EACH_CHILD() void ForEachChild(llvm::function_ref<void(Expression*)> f) override { return; }
 
-#define DEFAULT_TOLLMASCALBEFORE() std::string ToLLMascalBefore() override { return ""; }
+struct AST {
 
-#define DEFAULT_REPLACE_TARGET_NAME_TO() void ReplaceTargetNameTo(std::string from, std::string to) override { return; }
+	struct IntNumber;
 
-#define DEFAULT_CONTAINS_NAME() bool ContainsName(std::string str) override { return false; }
+	// Every node of a compilation is placed in an arena, and so are the
+	// lists of children, see Vector. No destructor runs for a node, the
+	// whole tree goes back in one go when the arenas are released. Each
+	// thread allocates from an arena of its own, so procedures can be
+	// parsed side by side.
+	struct Arena {
 
-struct AST {
+		llvm::BumpPtrAllocator allocator;
+
+		// The one thing a node can own outside the arena is the APInt of a
+		// literal wider than 64 bits. Literals are destroyed on release.
+		std::vector<IntNumber*> literals;
+	};
+
+	static thread_local Arena* arena;
+	static std::deque<Arena> arenas;
+	static std::mutex arenas_lock;
+
+	static Arena& ThreadArena() {
+
+		if(arena == nullptr) {
+
+			std::lock_guard<std::mutex> guard(arenas_lock);
+			arena = &arenas.emplace_back();
+		}
+
+		return *arena;
+	}
+
+	struct ArenaDelete {
+
+		template<typename T>
+		void operator()(T* p) const {}
+	};
+
+	template<typename T>
+	using Owned = std::unique_ptr<T, ArenaDelete>;
+
+	template<typename T, typename... Args>
+	static Owned<T> New(Args&&... args) {
+
+		return Owned<T>(new (ThreadArena().allocator.Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...));
+	}
+
+	// Gives vectors their buffers from the arena of the thread that grows
+	// them. A buffer outgrown is left where it is until the arena goes.
+	template<typename T>
+	struct ArenaAllocator {
+
+		typedef T value_type;
+
+		ArenaAllocator() = default;
+
+		template<typename U>
+		ArenaAllocator(const ArenaAllocator<U>&) {}
+
+		T* allocate(size_t n) { return static_cast<T*>(ThreadArena().allocator.Allocate(n * sizeof(T), alignof(T))); }
+
+		void deallocate(T* p, size_t n) {}
+
+		template<typename U>
+		bool operator==(const ArenaAllocator<U>&) const { return true; }
+
+		template<typename U>
+		bool operator!=(const ArenaAllocator<U>&) const { return false; }
+	};
+
+	template<typename T>
+	using Vector = std::vector<T, ArenaAllocator<T>>;
+
+	// Only called once no other thread is building nodes.
+	static void ReleaseArena();
+
+	// What a Type or an Expression is, for llvm::isa and llvm::dyn_cast.
+	// Every subclass passes its kind up and answers classof from it.
+	enum TypeKind {
+		TK_Integer128,
+		TK_Integer64,
+		TK_Integer32,
+		TK_Integer16,
+		TK_Integer8,
+		TK_Integer1,
+		TK_Void
+	};
+
+	enum ExpressionKind {
+		EK_IntNumber,
+		EK_Variable,
+		EK_Com,
+		EK_Mem,
+		EK_RetVoid,
+		EK_LLReturn,
+		EK_Add,
+		EK_Sub,
+		EK_IntCast,
+		EK_ComStore,
+		EK_LoadMem,
+		EK_MemStore,
+		EK_Compare,
+		EK_Binary,
+		EK_While,
+		EK_If,
+		EK_Call
+	};
 
 	struct Type {
 
+		const TypeKind kind;
+
+		Type(TypeKind kind_in) : kind(kind_in) {}
+
 		virtual ~Type() = default;
 
 		virtual llvm::Type* codegen() = 0;
 
-		virtual std::string ToLLMascal() = 0;
+		virtual llvm::StringRef ToLLMascal() = 0;
 
-		virtual std::unique_ptr<Type> Clone() = 0;
+		virtual unsigned BitWidth() = 0;
+
+		virtual Owned<Type> Clone() = 0;
 	};
 
-	NEW_TYPE(Integer128, return "i128"; );
-	NEW_TYPE(Integer64, return "i64"; );
-	NEW_TYPE(Integer32, return "i32"; );
-	NEW_TYPE(Integer16, return "i16"; );
-	NEW_TYPE(Integer8, return "i8"; );
-	NEW_TYPE(Integer1, return "i1"; );
+	NEW_TYPE(Integer128, return "i128"; , 128);
+	NEW_TYPE(Integer64, return "i64"; , 64);
+	NEW_TYPE(Integer32, return "i32"; , 32);
+	NEW_TYPE(Integer16, return "i16"; , 16);
+	NEW_TYPE(Integer8, return "i8"; , 8);
+	NEW_TYPE(Integer1, return "i1"; , 1);
 
-	NEW_TYPE(Void, return "void"; );
+	NEW_TYPE(Void, return "void"; , 0);
 
 	static int slash_t_count;
 
-	static std::string GetSlashT() {
+	static void SlashT(llvm::raw_ostream& out) {
 
-		std::string res;
 		for(int i = 0; i < slash_t_count; i++) {
-			res += "\t";
+			out << '\t';
 		}
-
-		return res;
 	}
 
 	struct Expression {
 
-		virtual ~Expression() = default;
+		const ExpressionKind kind;
+
+		Expression(ExpressionKind kind_in) : kind(kind_in) {}
 
-		std::string name;
+		virtual ~Expression() = default;
 
-		std::unique_ptr<Type> ty;
+		Symbol name = Symbols::None;
 
-		llvm::BasicBlock* parent_entry_block = nullptr;
+		Owned<Type> ty;
 
 		virtual llvm::Value* codegen() = 0;
 
-		virtual std::string ToLLMascal() = 0;
+		// LLMascal is written straight into 'out', nothing is built up in strings.
+		virtual void ToLLMascal(llvm::raw_ostream& out) = 0;
 
-		virtual std::string ToLLMascalBefore() = 0;
+		virtual void ToLLMascalBefore(llvm::raw_ostream& out) = 0;
 
-		virtual void ReplaceTargetNameTo(std::string from, std::string to) = 0;
+		// Calls 'f' on every direct subexpression.
+		virtual void ForEachChild(llvm::function_ref<void(Expression*)> f) = 0;
+	};
 
-		virtual bool ContainsName(std::string s) = 0;
+	// Writes what has to come before the line of 'e', if anything, and moves
+	// on to a new line.
+	static void EmitBefore(Expression* e, llvm::raw_ostream& out, bool indent = true) {
 
-		virtual std::unique_ptr<Expression> Clone() = 0;
-	};
+		uint64_t start = out.tell();
+
+		e->ToLLMascalBefore(out);
+
+		if(out.tell() == start) {
+			return;
+		}
+
+		out << '\n';
+
+		if(indent) {
+			SlashT(out);
+		}
+	}
+
+	// Writes the stores an 'if' or 'while' starts with, one line each.
+	static void EmitMemStores(const EXPR_OBJ_VECTOR()& stores, llvm::raw_ostream& out) {
+
+		for(size_t i = 0; i < stores.size(); i++) {
+
+			if(i != 0) {
+				out << '\n';
+				SlashT(out);
+			}
+
+			stores[i]->ToLLMascal(out);
+		}
+	}
 
 	struct IntNumber : public Expression {
 
-		int64_t num = 0;
+		EXPR_CLASSOF(IntNumber)
 
-		IntNumber(int64_t num_in, std::unique_ptr<Type> ty_in) {
+		llvm::APInt num;
 
-			num = num_in;
+		IntNumber(llvm::APInt num_in, Owned<Type> ty_in) : Expression(EK_IntNumber) {
+
+			num = std::move(num_in);
 			ty = std::move(ty_in);
+
+			ThreadArena().literals.push_back(this);
 		}
 
-		llvm::Value* codegen() override;
+		IntNumber(int64_t num_in, Owned<Type> ty_in) : Expression(EK_IntNumber) {
 
-		DEFAULT_TOLLMASCALBEFORE()
-		DEFAULT_REPLACE_TARGET_NAME_TO()
-		DEFAULT_CONTAINS_NAME()
+			num = llvm::APInt(ty_in->BitWidth(), num_in, true);
+			ty = std::move(ty_in);
 
-		std::string ToLLMascal() override {
-			return std::to_string(num);
+			ThreadArena().literals.push_back(this);
 		}
 
-		EXPR_OBJ() Clone() override {
+		llvm::Value* codegen() override;
 
-			return std::make_unique<IntNumber>(num, ty->Clone());
+		DEFAULT_TOLLMASCALBEFORE()
+		DEFAULT_FOR_EACH_CHILD()
+
+		// An i1 is printed as 0 or 1, not as 0 or -1.
+		void ToLLMascal(llvm::raw_ostream& out) override {
+			num.print(out, num.getBitWidth() > 1);
 		}
 	};
 
 	struct Variable : public Expression {
 
+		EXPR_CLASSOF(Variable)
+
 		EXPR_OBJ_VECTOR() initializers;
 
-		Variable(std::string name_in, EXPR_OBJ_VECTOR() initializers_in = {} ) {
+		Variable(Symbol name_in, EXPR_OBJ_VECTOR() initializers_in = {} ) : Expression(EK_Variable) {
 
 			initializers = std::move(initializers_in);
 			name = name_in;
@@ -124,54 +269,33 @@ struct AST {
 
 		llvm::Value* codegen() override;
 
-		std::string ToLLMascal() override {
-			return name;
+		void ToLLMascal(llvm::raw_ostream& out) override {
+			out << Symbols::Name(name);
 		}
 
-		std::string ToLLMascalBefore() override {
-
-			std::string res;
+		void ToLLMascalBefore(llvm::raw_ostream& out) override {
 
 			for(auto const& i : initializers) {
 
-				if(i->ToLLMascalBefore() != "") {
-
-					res += i->ToLLMascalBefore();
-					res += "\n";
-					res += GetSlashT();
-				}
+				EmitBefore(i.get(), out);
 			}
-
-			return res;
 		}
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
+		void ForEachChild(llvm::function_ref<void(Expression*)> f) override {
 
 			for(auto const& i : initializers) {
-				i->ReplaceTargetNameTo(from, to);
+				f(i.get());
 			}
 		}
-
-		bool ContainsName(std::string str) override {
-
-			return name == str;
-		}
-
-		EXPR_OBJ() Clone() override {
-
-			return std::make_unique<Variable>(name);
-		}
 	};
 
 	struct Com : public Expression {
 
+		EXPR_CLASSOF(Com)
+
 		EXPR_OBJ() target;
 
-		Com(std::string name_in, std::unique_ptr<Type> ty_in, EXPR_OBJ() target_in) {
+		Com(Symbol name_in, Owned<Type> ty_in, EXPR_OBJ() target_in) : Expression(EK_Com) {
 
 			name = name_in;
 			ty = std::move(ty_in);
@@ -180,55 +304,34 @@ struct AST {
 
 		llvm::Value* codegen() override;
 
-		std::string ToLLMascal() override {
-
-			std::string res;
-
-			if(target->ToLLMascalBefore() != "") {
-
-				res += target->ToLLMascalBefore();
-				res += "\n";
-				res += GetSlashT();
-			}
+		void ToLLMascal(llvm::raw_ostream& out) override {
 
-			res += "com ";
-			res += name;
-			res += ": ";
-			res += ty->ToLLMascal();
-			res += " = ";
-			res += target->ToLLMascal();
-			res += ";";
+			EmitBefore(target.get(), out);
 
-			return res;
+			out << "com ";
+			out << Symbols::Name(name);
+			out << ": ";
+			out << ty->ToLLMascal();
+			out << " = ";
+			target->ToLLMascal(out);
+			out << ";";
 		}
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
+		void ForEachChild(llvm::function_ref<void(Expression*)> f) override {
 
-			target->ReplaceTargetNameTo(from, to);
-		}
-
-		bool ContainsName(std::string str) override {
-
-			return name == str || target->ContainsName(str);
-		}
-
-		EXPR_OBJ() Clone() override {
-
-			return std::make_unique<Com>(name, ty->Clone(), target->Clone());
+			f(target.get());
 		}
 	};
 
 	struct Mem : public Expression {
 
+		EXPR_CLASSOF(Mem)
+
 		EXPR_OBJ() target;
 
-		Mem(std::string name_in, std::unique_ptr<Type> ty_in, EXPR_OBJ() target_in) {
+		Mem(Symbol name_in, Owned<Type> ty_in, EXPR_OBJ() target_in) : Expression(EK_Mem) {
 
 			name = name_in;
 			ty = std::move(ty_in);
@@ -237,120 +340,79 @@ struct AST {
 
 		llvm::Value* codegen() override;
 
-		std::string ToLLMascal() override {
-
-			std::string res;
-
-			if(target->ToLLMascalBefore() != "") {
-
-				res += target->ToLLMascalBefore();
-				res += "\n";
-				res += GetSlashT();
-			}
+		void ToLLMascal(llvm::raw_ostream& out) override {
 
-			res += "mem ";
-			res += name;
-			res += ": ";
-			res += ty->ToLLMascal();
-			res += " = ";
-			res += target->ToLLMascal();
-			res += ";";
+			EmitBefore(target.get(), out);
 
-			return res;
+			out << "mem ";
+			out << Symbols::Name(name);
+			out << ": ";
+			out << ty->ToLLMascal();
+			out << " = ";
+			target->ToLLMascal(out);
+			out << ";";
 		}
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
+		void ForEachChild(llvm::function_ref<void(Expression*)> f) override {
 
-			if(name == from) {
-				name = to;
-			}
-
-			target->ReplaceTargetNameTo(from, to);
-		}
-
-		bool ContainsName(std::string str) override {
-
-			return name == str || target->ContainsName(str);
-		}
-
-		EXPR_OBJ() Clone() override {
-
-			return std::make_unique<Mem>(name, ty->Clone(), target->Clone());
+			f(target.get());
 		}
 	};
 
 	struct RetVoid : public Expression {
 
-		RetVoid() {}
+		EXPR_CLASSOF(RetVoid)
+
+		RetVoid() : Expression(EK_RetVoid) {}
 
 		llvm::Value* codegen() override;
 
 		EMPTY_TOLLMASCAL()
 		DEFAULT_TOLLMASCALBEFORE()
-		DEFAULT_REPLACE_TARGET_NAME_TO()
-		DEFAULT_CONTAINS_NAME()
+		DEFAULT_FOR_EACH_CHILD()
 
-		EXPR_OBJ() Clone() override {
-
-			return std::make_unique<RetVoid>();
-		}
 	};
 
 	struct LLReturn : public Expression {
 
+		EXPR_CLASSOF(LLReturn)
+
 		EXPR_OBJ() target;
 
-		LLReturn(EXPR_OBJ() target_in) {
+		LLReturn(EXPR_OBJ() target_in) : Expression(EK_LLReturn) {
 
 			target = std::move(target_in);
 		}
 
 		llvm::Value* codegen() override;
 
-		std::string ToLLMascal() override {
+		void ToLLMascal(llvm::raw_ostream& out) override {
 
-			std::string res;
+			EmitBefore(target.get(), out);
 
-			if(target->ToLLMascalBefore() != "") {
-
-				res += target->ToLLMascalBefore();
-				res += "\n";
-				res += GetSlashT();
-			}
-
-			res += "llreturn ";
-			res += target->ToLLMascal();
-			res += ";";
-
-			return res;
+			out << "llreturn ";
+			target->ToLLMascal(out);
+			out << ";";
 		}
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			target->ReplaceTargetNameTo(from, to);
-		}
-
-		bool ContainsName(std::string str) override {
+		void ForEachChild(llvm::function_ref<void(Expression*)> f) override {
 
-			return name == str || target->ContainsName(str);
-		}
-
-		EXPR_OBJ() Clone() override {
-
-			return std::make_unique<LLReturn>(target->Clone());
+			f(target.get());
 		}
 	};
 
 	struct Add : public Expression {
 
+		EXPR_CLASSOF(Add)
+
 		EXPR_OBJ() target;
 		EXPR_OBJ() value;
 
-		Add(EXPR_OBJ() target_in, EXPR_OBJ() value_in) {
+		Add(EXPR_OBJ() target_in, EXPR_OBJ() value_in) : Expression(EK_Add) {
 
 			target = std::move(target_in);
 			value = std::move(value_in);
@@ -360,55 +422,34 @@ struct AST {
 
 		llvm::Value* codegen() override;
 
-		std::string ToLLMascal() override {
+		void ToLLMascal(llvm::raw_ostream& out) override {
 
-			std::string res;
+			EmitBefore(value.get(), out);
 
-			if(value->ToLLMascalBefore() != "") {
-
-				res += value->ToLLMascalBefore();
-				res += "\n";
-				res += GetSlashT();
-			}
-
-			res += "add ";
-			res += target->ToLLMascal();
-			res += ", ";
-			res += value->ToLLMascal();
-			res += ";";
-
-			return res;
+			out << "add ";
+			target->ToLLMascal(out);
+			out << ", ";
+			value->ToLLMascal(out);
+			out << ";";
 		}
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
+		void ForEachChild(llvm::function_ref<void(Expression*)> f) override {
 
-			if(name == from) {
-				name = to;
-			}
-
-			target->ReplaceTargetNameTo(from, to);
-			value->ReplaceTargetNameTo(from, to);
-		}
-
-		bool ContainsName(std::string str) override {
-
-			return name == str || target->ContainsName(str) || value->ContainsName(str);
-		}
-
-		EXPR_OBJ() Clone() override {
-
-			return std::make_unique<Add>(target->Clone(), value->Clone());
+			f(target.get());
+			f(value.get());
 		}
 	};
 
 	struct Sub : public Expression {
 
+		EXPR_CLASSOF(Sub)
+
 		EXPR_OBJ() target;
 		EXPR_OBJ() value;
 
-		Sub(EXPR_OBJ() target_in, EXPR_OBJ() value_in) {
+		Sub(EXPR_OBJ() target_in, EXPR_OBJ() value_in) : Expression(EK_Sub) {
 
 			target = std::move(target_in);
 			value = std::move(value_in);
@@ -418,55 +459,34 @@ struct AST {
 
 		llvm::Value* codegen() override;
 
-		std::string ToLLMascal() override {
-
-			std::string res;
+		void ToLLMascal(llvm::raw_ostream& out) override {
 
-			if(value->ToLLMascalBefore() != "") {
+			EmitBefore(value.get(), out);
 
-				res += value->ToLLMascalBefore();
-				res += "\n";
-				res += GetSlashT();
-			}
-
-			res += "sub ";
-			res += target->ToLLMascal();
-			res += ", ";
-			res += value->ToLLMascal();
-			res += ";";
-
-			return res;
+			out << "sub ";
+			target->ToLLMascal(out);
+			out << ", ";
+			value->ToLLMascal(out);
+			out << ";";
 		}
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		bool ContainsName(std::string str) override {
-
-			return name == str || target->ContainsName(str) || value->ContainsName(str);
-		}
-
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
-
-			target->ReplaceTargetNameTo(from, to);
-			value->ReplaceTargetNameTo(from, to);
-		}
-
-		EXPR_OBJ() Clone() override {
+		void ForEachChild(llvm::function_ref<void(Expression*)> f) override {
 
-			return std::make_unique<Sub>(target->Clone(), value->Clone());
+			f(target.get());
+			f(value.get());
 		}
 	};
 
 	struct IntCast : public Expression {
 
+		EXPR_CLASSOF(IntCast)
+
 		EXPR_OBJ() target;
 		TYPE_OBJ() intType;
 
-		IntCast(EXPR_OBJ() target_in, TYPE_OBJ() intType_in) {
+		IntCast(EXPR_OBJ() target_in, TYPE_OBJ() intType_in) : Expression(EK_IntCast) {
 
 			target = std::move(target_in);
 			intType = std::move(intType_in);
@@ -474,54 +494,33 @@ struct AST {
 
 		llvm::Value* codegen() override;
 
-		std::string ToLLMascal() override {
-
-			std::string res;
-
-			res += "intcast ";
-			res += target->ToLLMascal();
-			res += " to ";
-			res += intType->ToLLMascal();
+		void ToLLMascal(llvm::raw_ostream& out) override {
 
-			return res;
+			out << "intcast ";
+			target->ToLLMascal(out);
+			out << " to ";
+			out << intType->ToLLMascal();
 		}
 
-		std::string ToLLMascalBefore() override {
-
-			std::string res;
-
-			if(target->ToLLMascalBefore() != "") {
-
-				res += target->ToLLMascalBefore();
-				res += "\n";
-				res += GetSlashT();
-			}
+		void ToLLMascalBefore(llvm::raw_ostream& out) override {
 
-			return res;
+			EmitBefore(target.get(), out);
 		}
 
-		bool ContainsName(std::string str) override {
+		void ForEachChild(llvm::function_ref<void(Expression*)> f) override {
 
-			return target->ContainsName(str);
-		}
-
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			target->ReplaceTargetNameTo(from, to);
-		}
-
-		EXPR_OBJ() Clone() override {
-
-			return std::make_unique<IntCast>(target->Clone(), intType->Clone());
+			f(target.get());
 		}
 	};
 
 	struct ComStore : public Expression {
 
+		EXPR_CLASSOF(ComStore)
+
 		EXPR_OBJ() target;
 		EXPR_OBJ() value;
 
-		ComStore(EXPR_OBJ() target_in, EXPR_OBJ() value_in) {
+		ComStore(EXPR_OBJ() target_in, EXPR_OBJ() value_in) : Expression(EK_ComStore) {
 
 			target = std::move(target_in);
 			value = std::move(value_in);
@@ -531,105 +530,64 @@ struct AST {
 
 		llvm::Value* codegen() override;
 
-		std::string ToLLMascal() override {
-
-			std::string res;
+		void ToLLMascal(llvm::raw_ostream& out) override {
 
-			if(value->ToLLMascalBefore() != "") {
-
-				res += value->ToLLMascalBefore();
-				res += "\n";
-				res += GetSlashT();
-			}
+			EmitBefore(value.get(), out);
 
-			res += "comstore ";
-			res += target->ToLLMascal();
-			res += ", ";
-			res += value->ToLLMascal();
-			res += ";";
-
-			return res;
+			out << "comstore ";
+			target->ToLLMascal(out);
+			out << ", ";
+			value->ToLLMascal(out);
+			out << ";";
 		}
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			if(name == from) {
-				name = to;
-			}
-
-			target->ReplaceTargetNameTo(from, to);
-			value->ReplaceTargetNameTo(from, to);
-		}
-
-		bool ContainsName(std::string str) override {
-
-			return name == str || target->ContainsName(str) || value->ContainsName(str);
-		}
-
-		EXPR_OBJ() Clone() override {
+		void ForEachChild(llvm::function_ref<void(Expression*)> f) override {
 
-			return std::make_unique<ComStore>(target->Clone(), value->Clone());
+			f(target.get());
+			f(value.get());
 		}
 	};
 
 	struct LoadMem : public Expression {
 
+		EXPR_CLASSOF(LoadMem)
+
 		EXPR_OBJ() target;
 
-		LoadMem(EXPR_OBJ() target_in) {
+		LoadMem(EXPR_OBJ() target_in) : Expression(EK_LoadMem) {
 
 			target = std::move(target_in);
 		}
 
 		llvm::Value* codegen() override;
 
-		std::string ToLLMascalBefore() override {
-
-			std::string res;
-
-			if(target->ToLLMascalBefore() != "") {
-
-				res += target->ToLLMascalBefore();
-				res += "\n";
-			}
-
-			return res;
-		}
-
-		std::string ToLLMascal() override {
-
-			std::string res;
+		void ToLLMascalBefore(llvm::raw_ostream& out) override {
 
-			res += "loadmem ";
-			res += target->ToLLMascal();
-
-			return res;
+			EmitBefore(target.get(), out, false);
 		}
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
+		void ToLLMascal(llvm::raw_ostream& out) override {
 
-			target->ReplaceTargetNameTo(from, to);
+			out << "loadmem ";
+			target->ToLLMascal(out);
 		}
 
-		bool ContainsName(std::string str) override {
+		void ForEachChild(llvm::function_ref<void(Expression*)> f) override {
 
-			return name == str || target->ContainsName(str);
-		}
-
-		EXPR_OBJ() Clone() override {
-
-			return std::make_unique<LoadMem>(target->Clone());
+			f(target.get());
 		}
 	};
 
 	struct MemStore : public Expression {
 
+		EXPR_CLASSOF(MemStore)
+
 		EXPR_OBJ() target;
 		EXPR_OBJ() value;
 
-		MemStore(EXPR_OBJ() target_in, EXPR_OBJ() value_in) {
+		MemStore(EXPR_OBJ() target_in, EXPR_OBJ() value_in) : Expression(EK_MemStore) {
 
 			target = std::move(target_in);
 			value = std::move(value_in);
@@ -639,46 +597,23 @@ struct AST {
 
 		llvm::Value* codegen() override;
 
-		std::string ToLLMascal() override {
-
-			std::string res;
-
-			if(value->ToLLMascalBefore() != "") {
-
-				res += value->ToLLMascalBefore();
-				res += "\n";
-				res += GetSlashT();
-			}
+		void ToLLMascal(llvm::raw_ostream& out) override {
 
-			res += "memstore ";
-			res += target->ToLLMascal();
-			res += ", ";
-			res += value->ToLLMascal();
-			res += ";";
+			EmitBefore(value.get(), out);
 
-			return res;
+			out << "memstore ";
+			target->ToLLMascal(out);
+			out << ", ";
+			value->ToLLMascal(out);
+			out << ";";
 		}
 
 		DEFAULT_TOLLMASCALBEFORE()
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
+		void ForEachChild(llvm::function_ref<void(Expression*)> f) override {
 
-			if(name == from) {
-				name = to;
-			}
-
-			target->ReplaceTargetNameTo(from, to);
-			value->ReplaceTargetNameTo(from, to);
-		}
-
-		bool ContainsName(std::string str) override {
-
-			return name == str || target->ContainsName(str) || value->ContainsName(str);
-		}
-
-		EXPR_OBJ() Clone() override {
-
-			return std::make_unique<MemStore>(target->Clone(), value->Clone());
+			f(target.get());
+			f(value.get());
 		}
 	};
 
@@ -693,12 +628,14 @@ struct AST {
 
 	struct Compare : public Expression {
 
+		EXPR_CLASSOF(Compare)
+
 		EXPR_OBJ() compareOne;
 		EXPR_OBJ() compareTwo;
 
 		int cmp_type;
 
-		Compare(EXPR_OBJ() compareOne_in, EXPR_OBJ() compareTwo_in, int cmp_type_in) {
+		Compare(EXPR_OBJ() compareOne_in, EXPR_OBJ() compareTwo_in, int cmp_type_in) : Expression(EK_Compare) {
 
 			compareOne = std::move(compareOne_in);
 			compareTwo = std::move(compareTwo_in);
@@ -708,320 +645,322 @@ struct AST {
 
 		llvm::Value* codegen() override;
 
-		std::string ToLLMascal() override {
+		void ToLLMascal(llvm::raw_ostream& out) override {
 
-			std::string res;
+			EmitBefore(compareOne.get(), out);
 
-			if(compareOne->ToLLMascalBefore() != "") {
+			EmitBefore(compareTwo.get(), out);
 
-				res += compareOne->ToLLMascalBefore();
-				res += "\n";
-				res += GetSlashT();
-			}
+			out << "COMPARE.";
+			
+			if(cmp_type == CompareType::IsLessThan) { out << "IsLessThan"; }
+			else if(cmp_type == CompareType::IsMoreThan) { out << "IsMoreThan"; }
+			else if(cmp_type == CompareType::IsEquals) { out << "IsEquals"; }
+			else if(cmp_type == CompareType::IsNotEquals) { out << "IsNotEquals"; }
+			else if(cmp_type == CompareType::IsLessThanOrEquals) { out << "IsLessThanOrEquals"; }
+			else if(cmp_type == CompareType::IsMoreThanOrEquals) { out << "IsMoreThanOrEquals"; }
 
-			if(compareTwo->ToLLMascalBefore() != "") {
+			out << "(";
+			compareOne->ToLLMascal(out);
+			out << ", ";
+			compareTwo->ToLLMascal(out);
+			out << ")";
+		}
 
-				res += compareTwo->ToLLMascalBefore();
-				res += "\n";
-				res += GetSlashT();
-			}
+		DEFAULT_TOLLMASCALBEFORE()
 
-			res += "COMPARE.";
-			
-			if(cmp_type == CompareType::IsLessThan) { res += "IsLessThan"; }
-			else if(cmp_type == CompareType::IsMoreThan) { res += "IsMoreThan"; }
-			else if(cmp_type == CompareType::IsEquals) { res += "IsEquals"; }
-			else if(cmp_type == CompareType::IsNotEquals) { res += "IsNotEquals"; }
-			else if(cmp_type == CompareType::IsLessThanOrEquals) { res += "IsLessThanOrEquals"; }
-			else if(cmp_type == CompareType::IsMoreThanOrEquals) { res += "IsMoreThanOrEquals"; }
+		void ForEachChild(llvm::function_ref<void(Expression*)> f) override {
 
-			res += "(";
-			res += compareOne->ToLLMascal();
-			res += ", ";
-			res += compareTwo->ToLLMascal();
-			res += ")";
+			f(compareOne.get());
+			f(compareTwo.get());
+		}
+	};
+
+	enum BinaryType {
+		Plus,
+		Minus,
+		Times,
+		Divide,
+		Remainder,
+		ShiftLeft,
+		ShiftRight,
+		BitAnd,
+		BitOr,
+		BitXor
+	};
 
-			return res;
+	// An infix operator. Unlike 'add' and 'sub' it writes to no com, it only
+	// gives a value. Division, remainder and right shift are signed.
+	struct Binary : public Expression {
+
+		EXPR_CLASSOF(Binary)
+
+		EXPR_OBJ() left;
+		EXPR_OBJ() right;
+
+		int op;
+
+		Binary(EXPR_OBJ() left_in, EXPR_OBJ() right_in, int op_in) : Expression(EK_Binary) {
+
+			left = std::move(left_in);
+			right = std::move(right_in);
+
+			op = op_in;
 		}
 
-		DEFAULT_TOLLMASCALBEFORE()
+		llvm::Value* codegen() override;
+
+		static llvm::StringRef OperatorText(int op) {
 
-		bool ContainsName(std::string str) override {
+			if(op == BinaryType::Plus) { return "+"; }
+			else if(op == BinaryType::Minus) { return "-"; }
+			else if(op == BinaryType::Times) { return "*"; }
+			else if(op == BinaryType::Divide) { return "/"; }
+			else if(op == BinaryType::Remainder) { return "%"; }
+			else if(op == BinaryType::ShiftLeft) { return "<<"; }
+			else if(op == BinaryType::ShiftRight) { return ">>"; }
+			else if(op == BinaryType::BitAnd) { return "&"; }
+			else if(op == BinaryType::BitOr) { return "|"; }
 
-			return name == str || compareOne->ContainsName(str) || compareTwo->ContainsName(str);
+			return "^";
 		}
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
+		void ToLLMascal(llvm::raw_ostream& out) override {
 
-			if(name == from) {
-				name = to;
-			}
+			out << "(";
+			left->ToLLMascal(out);
+			out << " ";
+			out << OperatorText(op);
+			out << " ";
+			right->ToLLMascal(out);
+			out << ")";
+		}
+
+		void ToLLMascalBefore(llvm::raw_ostream& out) override {
 
-			compareOne->ReplaceTargetNameTo(from, to);
-			compareTwo->ReplaceTargetNameTo(from, to);
+			EmitBefore(left.get(), out);
+
+			EmitBefore(right.get(), out);
 		}
 
-		EXPR_OBJ() Clone() override {
+		void ForEachChild(llvm::function_ref<void(Expression*)> f) override {
 
-			return std::make_unique<Compare>(compareOne->Clone(), compareTwo->Clone(), cmp_type);
+			f(left.get());
+			f(right.get());
 		}
 	};
 
 	struct While : public Expression {
 
+		EXPR_CLASSOF(While)
+
 		EXPR_OBJ() condition;
 		EXPR_OBJ_VECTOR() loop_body;
 
-		While(EXPR_OBJ() condition_in, EXPR_OBJ_VECTOR() loop_body_in) {
+		// Mems written back before the loop, so it starts with all of them in memory.
+		EXPR_OBJ_VECTOR() mem_stores;
+
+		While(EXPR_OBJ() condition_in, EXPR_OBJ_VECTOR() loop_body_in, EXPR_OBJ_VECTOR() mem_stores_in = {}) : Expression(EK_While) {
 
 			condition = std::move(condition_in);
 			loop_body = std::move(loop_body_in);
+			mem_stores = std::move(mem_stores_in);
 		}
 
 		llvm::Value* codegen() override;
 
-		std::string ToLLMascal() override {
-
-			std::string res;
+		void ToLLMascal(llvm::raw_ostream& out) override {
 
-			if(condition->ToLLMascalBefore() != "") {
-
-				res += condition->ToLLMascalBefore();
-				res += "\n";
-				res += GetSlashT();
-			}
+			EmitBefore(condition.get(), out);
 
-			res += "while ";
+			out << "while ";
 			
-			res += condition->ToLLMascal();
-			res += " do\n";
+			condition->ToLLMascal(out);
+			out << " do\n";
 
 			slash_t_count += 1;
 
 			for(auto const& i: loop_body) {
-				res += GetSlashT();
-				res += i->ToLLMascalBefore();
-				res += "\n";
+				SlashT(out);
+				i->ToLLMascalBefore(out);
+				out << "\n";
 
-				res += GetSlashT();
-				res += i->ToLLMascal();
-				res += "\n";
+				SlashT(out);
+				i->ToLLMascal(out);
+				out << "\n";
 			}
 
 			slash_t_count -= 1;
 
-			res += GetSlashT() + "end;\n";
+			SlashT(out);
+			out << "end;\n";
 			
-			return res;
 		}
 
-		DEFAULT_TOLLMASCALBEFORE()
-
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			condition->ReplaceTargetNameTo(from, to);
-
-			for(auto const& i : loop_body) {
+		void ToLLMascalBefore(llvm::raw_ostream& out) override {
 
-				i->ReplaceTargetNameTo(from, to);
-			}
+			EmitMemStores(mem_stores, out);
 		}
 
-		bool ContainsName(std::string str) override {
+		void ForEachChild(llvm::function_ref<void(Expression*)> f) override {
 
-			if(condition->ContainsName(str)) {
-				return true;
+			for(auto const& i : mem_stores) {
+				f(i.get());
 			}
 
+			f(condition.get());
+
 			for(auto const& i : loop_body) {
-				if(i->ContainsName(str)) {
-					return true;
-				}
+				f(i.get());
 			}
-
-			return false;
-		}
-
-		EXPR_OBJ() Clone() override {
-
-			CLONE_EXPR_VECTOR(loop_body, clone_loop_body);
-
-			return std::make_unique<While>(condition->Clone(), std::move(clone_loop_body));
 		}
 	};
 
 	struct If : public Expression {
 
+		EXPR_CLASSOF(If)
+
 		EXPR_OBJ() condition;
 		EXPR_OBJ_VECTOR() if_body;
 		EXPR_OBJ_VECTOR() else_body;
 
-		If(EXPR_OBJ() condition_in, EXPR_OBJ_VECTOR() if_body_in, EXPR_OBJ_VECTOR() else_body_in) {
+		// Mems written back before the branch, so both ways start with all of them in memory.
+		EXPR_OBJ_VECTOR() mem_stores;
+
+		If(EXPR_OBJ() condition_in, EXPR_OBJ_VECTOR() if_body_in, EXPR_OBJ_VECTOR() else_body_in, EXPR_OBJ_VECTOR() mem_stores_in = {}) : Expression(EK_If) {
 
 			condition = std::move(condition_in);
 			if_body = std::move(if_body_in);
 			else_body = std::move(else_body_in);
+			mem_stores = std::move(mem_stores_in);
 		}
 
 		llvm::Value* codegen() override;
 
-		std::string ToLLMascal() override {
+		void ToLLMascal(llvm::raw_ostream& out) override {
 
-			std::string res;
+			EmitBefore(condition.get(), out);
 
-			if(condition->ToLLMascalBefore() != "") {
-
-				res += condition->ToLLMascalBefore();
-				res += "\n";
-				res += GetSlashT();
-			}
-
-			res += "if ";
+			out << "if ";
 			
-			res += condition->ToLLMascal();
-			res += " then\n";
+			condition->ToLLMascal(out);
+			out << " then\n";
 
 			slash_t_count += 1;
 
 			for(auto const& i: if_body) {
-				res += GetSlashT();
-				res += i->ToLLMascalBefore();
-				res += "\n";
+				SlashT(out);
+				i->ToLLMascalBefore(out);
+				out << "\n";
 
-				res += GetSlashT();
-				res += i->ToLLMascal();
-				res += "\n";
+				SlashT(out);
+				i->ToLLMascal(out);
+				out << "\n";
 			}
 
 			slash_t_count -= 1;
 
 			if(else_body.size() != 0) {
 				
-				res += GetSlashT() + "else then\n";
+				SlashT(out);
+				out << "else then\n";
 	
 				slash_t_count += 1;
 	
 				for(auto const& i: else_body) {
-					res += GetSlashT();
-					res += i->ToLLMascalBefore();
-					res += "\n";
+					SlashT(out);
+					i->ToLLMascalBefore(out);
+					out << "\n";
 
-					res += GetSlashT();
-					res += i->ToLLMascal();
-					res += "\n";
+					SlashT(out);
+					i->ToLLMascal(out);
+					out << "\n";
 				}
 	
 				slash_t_count -= 1;
 			}
 
-			res += GetSlashT() + "end;\n";
+			SlashT(out);
+			out << "end;\n";
 			
-			return res;
 		}
 
-		DEFAULT_TOLLMASCALBEFORE()
+		void ToLLMascalBefore(llvm::raw_ostream& out) override {
 
-		void ReplaceTargetNameTo(std::string from, std::string to) override {
-
-			condition->ReplaceTargetNameTo(from, to);
-
-			for(auto const& i : if_body) {
-
-				i->ReplaceTargetNameTo(from, to);
-			}
-
-			for(auto const& i : else_body) {
-
-				i->ReplaceTargetNameTo(from, to);
-			}
+			EmitMemStores(mem_stores, out);
 		}
 
-		bool ContainsName(std::string str) override {
+		void ForEachChild(llvm::function_ref<void(Expression*)> f) override {
 
-			if(condition->ContainsName(str)) {
-				return true;
+			for(auto const& i : mem_stores) {
+				f(i.get());
 			}
 
+			f(condition.get());
+
 			for(auto const& i : if_body) {
-				if(i->ContainsName(str)) {
-					return true;
-				}
+				f(i.get());
 			}
 
 			for(auto const& i : else_body) {
-				if(i->ContainsName(str)) {
-					return true;
-				}
+				f(i.get());
 			}
-
-			return false;
-		}
-
-		EXPR_OBJ() Clone() override {
-
-			CLONE_EXPR_VECTOR(if_body, clone_if_body);
-			CLONE_EXPR_VECTOR(else_body, clone_else_body);
-
-			return std::make_unique<If>(condition->Clone(), std::move(clone_if_body), std::move(clone_else_body));
 		}
 	};
 
-	struct ProcedureCall : public Expression {
+	struct Call : public Expression {
 
-		EXPR_OBJ_VECTOR() body;
-		EXPR_OBJ() return_obj;
+		EXPR_CLASSOF(Call)
 
-		ProcedureCall(EXPR_OBJ_VECTOR() body_in, EXPR_OBJ() return_obj_in) {
+		Symbol callee;
+		EXPR_OBJ_VECTOR() arguments;
 
-			body = std::move(body_in);
-			return_obj = std::move(return_obj_in);
+		Call(Symbol callee_in, EXPR_OBJ_VECTOR() arguments_in, TYPE_OBJ() ty_in) : Expression(EK_Call) {
+
+			callee = callee_in;
+			arguments = std::move(arguments_in);
+			ty = std::move(ty_in);
 		}
 
 		llvm::Value* codegen() override;
 
-		std::string ToLLMascal() override {
-			return return_obj->ToLLMascal();
-		}
+		void ToLLMascal(llvm::raw_ostream& out) override {
 
-		std::string ToLLMascalBefore() override {
+			out << Symbols::Name(callee);
+			out << "(";
 
-			std::string res;
-
-			for(auto const& i: body) {
+			for(size_t i = 0; i < arguments.size(); i++) {
 
-				if(i->ToLLMascalBefore() != "") {
-
-					res += i->ToLLMascalBefore();
-					res += "\n";
-					res += GetSlashT();
+				if(i != 0) {
+					out << ", ";
 				}
 
-				res += GetSlashT();
-				res += i->ToLLMascal();
-				res += "\n";
+				arguments[i]->ToLLMascal(out);
 			}
 
-			return res;
+			out << ")";
 		}
 
-		DEFAULT_REPLACE_TARGET_NAME_TO()
+		void ToLLMascalBefore(llvm::raw_ostream& out) override {
 
-		DEFAULT_CONTAINS_NAME()
+			for(auto const& i: arguments) {
 
-		EXPR_OBJ() Clone() override {
+				EmitBefore(i.get(), out);
+			}
+		}
 
-			CLONE_EXPR_VECTOR(body, body_clone);
+		void ForEachChild(llvm::function_ref<void(Expression*)> f) override {
 
-			return std::make_unique<AST::ProcedureCall>(std::move(body_clone), return_obj->Clone());
+			for(auto const& i : arguments) {
+				f(i.get());
+			}
 		}
-
 	};
 
 	struct Procedure {
 
-		std::string procName;
+		Symbol procName;
 
-		std::vector<std::string> all_argument_var_types;
 		EXPR_OBJ_VECTOR() all_arguments;
 		TYPE_OBJ_VECTOR() all_argument_types;
 
@@ -1029,55 +968,76 @@ struct AST {
 
 		EXPR_OBJ_VECTOR() body;
 
-		int call_count = 0;
+		// The com that 'return' stores into, None for void procedures.
+		Symbol returnName = Symbols::None;
+
+		// Bodies are parsed on several threads, each counting its calls here.
+		std::atomic<int> call_count = 0;
 
-		Procedure(std::string procName_in, std::vector<std::string> all_argument_var_types_in, EXPR_OBJ_VECTOR() all_arguments_in, TYPE_OBJ_VECTOR() all_argument_types_in, TYPE_OBJ() proc_type_in) {
+		Procedure(Symbol procName_in, EXPR_OBJ_VECTOR() all_arguments_in, TYPE_OBJ_VECTOR() all_argument_types_in, TYPE_OBJ() proc_type_in) {
 
 			procName = procName_in;
 
-			all_argument_var_types = all_argument_var_types_in;
 			all_arguments = std::move(all_arguments_in);
 			all_argument_types = std::move(all_argument_types_in);
 
 			proc_type = std::move(proc_type_in);
 		}
 
-		Procedure(std::string procName_in, std::vector<std::string> all_argument_var_types_in, EXPR_OBJ_VECTOR() all_arguments_in, TYPE_OBJ_VECTOR() all_argument_types_in, TYPE_OBJ() proc_type_in, EXPR_OBJ_VECTOR() body_in) {
 
-			procName = procName_in;
+		// The function is created on first use, so calls to a procedure can
+		// be generated before its body.
+		llvm::Function* Declare();
 
-			all_argument_var_types = all_argument_var_types_in;
-			all_arguments = std::move(all_arguments_in);
-			all_argument_types = std::move(all_argument_types_in);
+		llvm::Function* codegen();
 
-			proc_type = std::move(proc_type_in);
+		void ToLLMascal(llvm::raw_ostream& out) {
 
-			body = std::move(body_in);
-		}
+			slash_t_count = 0;
 
-		std::unique_ptr<AST::Procedure> Clone() {
+			out << "proc ";
 
-			CLONE_EXPR_VECTOR(all_arguments, all_arguments_clone);
-			CLONE_TYPE_VECTOR(all_argument_types, all_argument_types_clone);
+			out << Symbols::Name(procName);
+			out << "(";
 
-			CLONE_EXPR_VECTOR(body, body_clone);
+			for(size_t i = 0; i < all_arguments.size(); i++) {
 
-			auto proc = std::make_unique<AST::Procedure>(procName, all_argument_var_types, std::move(all_arguments_clone), std::move(all_argument_types_clone), proc_type->Clone(), std::move(body_clone));
+				if(i != 0) {
+					out << ", ";
+				}
 
-			proc->call_count = call_count;
+				out << "com ";
+				all_arguments[i]->ToLLMascal(out);
+				out << ": ";
+				out << all_argument_types[i]->ToLLMascal();
+			}
 
-			return proc;
-		}
+			out << "): ";
+			out << proc_type->ToLLMascal();
+			out << " begin\n";
 
-		std::unique_ptr<AST::Procedure> CloneWithoutBody() {
+			slash_t_count += 1;
 
-			CLONE_EXPR_VECTOR(all_arguments, all_arguments_clone);
-			CLONE_TYPE_VECTOR(all_argument_types, all_argument_types_clone);
+			for(auto const& i: body) {
 
-			return std::make_unique<AST::Procedure>(procName, all_argument_var_types, std::move(all_arguments_clone), std::move(all_argument_types_clone), proc_type->Clone());
-		}
+				SlashT(out);
+				EmitBefore(i.get(), out);
+				i->ToLLMascal(out);
+				out << "\n";
+			}
+
+			if(returnName != Symbols::None) {
+
+				SlashT(out);
+				out << "llreturn ";
+				out << Symbols::Name(returnName);
+				out << ";\n";
+			}
+
+			slash_t_count -= 1;
 
-		llvm::Value* codegen();
+			out << "end\n\n";
+		}
 	};
 
 	struct Attributes {
@@ -1095,57 +1055,46 @@ struct AST {
 
 		llvm::Function* codegen();
 
-		std::string ToLLMascal() {
+		void ToLLMascal(llvm::raw_ostream& out) {
 
 			slash_t_count = 0;
 
-			std::string res = "program begin\n";
+			out << "program begin\n";
 
 			slash_t_count += 1;
 
 			for(auto const& i: all_instructions) {
 
-				if(i->ToLLMascalBefore() != "") {
-
-					res += GetSlashT();
-					res += i->ToLLMascalBefore();
-					res += "\n";
-				}
-
-				res += GetSlashT();
-				res += i->ToLLMascal();
-				res += "\n";
+				SlashT(out);
+				EmitBefore(i.get(), out);
+				i->ToLLMascal(out);
+				out << "\n";
 			}
 
 			slash_t_count -= 1;
 
-			res += "end\n";
-
-			return res;
+			out << "end\n";
 		}
 	};
 
 	static llvm::Value* GetCurrentInstruction(AST::Expression* e);
-	static llvm::Value* GetCurrentInstructionByName(std::string name);
+	static llvm::Value* GetCurrentInstructionByName(Symbol name);
 
 	static llvm::Value* GetOrCreateInstruction(AST::Expression* e);
 
 	static llvm::Value* GetAllocaFromMem(AST::Expression* e);
 
 	static void AddInstruction(AST::Expression* e, llvm::Value* l);
-	static void AddInstructionToName(std::string name, llvm::Value* l);
+	static void AddInstructionToName(Symbol name, llvm::Value* l);
 
-	static void GlobalSaveState(llvm::BasicBlock* bb);
-	
-	static void SaveState(std::string name, llvm::BasicBlock* bb);
-	static void SetExistingState(std::string name, llvm::BasicBlock* bb);
-	static llvm::Value* FindExistingState(std::string name, llvm::BasicBlock* bb);
+	static llvm::Value* ReadCom(Symbol name, LLVM_Com* com, llvm::BasicBlock* bb);
+	static llvm::Value* ReadComFromPredecessors(Symbol name, LLVM_Com* com, llvm::BasicBlock* bb);
 
-	static void CreateIfPHIs(llvm::BasicBlock* continueBlock);
-	static void CreateIfElsePHIs(llvm::BasicBlock* continueBlock);
+	static llvm::PHINode* CreateComPHI(LLVM_Com* com, llvm::BasicBlock* bb);
+	static llvm::Value* AddPHIOperands(Symbol name, LLVM_Com* com, llvm::PHINode* phi);
+	static llvm::Value* RemoveTrivialPHI(llvm::PHINode* phi);
 
-	static bool IsInitializer(AST::Expression* t);
-	static bool IsAlgorithm(AST::Expression* t);
+	static void SealBlock(llvm::BasicBlock* bb);
 };
 
 #endif
\ No newline at end of file
@@ -4,12 +4,21 @@ std::unique_ptr<llvm::LLVMContext> 	CodeGen::TheContext;
 std::unique_ptr<llvm::IRBuilder<>> 	CodeGen::Builder;
 std::unique_ptr<llvm::Module> 		CodeGen::TheModule;
 
-std::unordered_map<std::string, std::unique_ptr<LLVM_Com>> CodeGen::all_coms;
-std::unordered_map<std::string, std::unique_ptr<LLVM_Mem>> CodeGen::all_mems;
+std::unique_ptr<llvm::TargetMachine> CodeGen::TheTargetMachine;
 
-bool CodeGen::releaseMode = false;
+llvm::MapVector<Symbol, std::unique_ptr<LLVM_Com>> CodeGen::all_coms;
+llvm::MapVector<Symbol, std::unique_ptr<LLVM_Mem>> CodeGen::all_mems;
 
-std::vector<llvm::PHINode*> CodeGen::all_phi_nodes;
+char CodeGen::optimizationLevel = '0';
+
+bool CodeGen::report = false;
+
+std::string CodeGen::emit = "ir";
+std::string CodeGen::output;
+
+int CodeGen::exitCode = 0;
+
+llvm::DenseMap<llvm::BasicBlock*, llvm::MapVector<Symbol, llvm::PHINode*>> CodeGen::unsealed_blocks;
 
 void CodeGen::Initialize()
 {
@@ -17,36 +26,268 @@ void CodeGen::Initialize()
  	TheContext = std::make_unique<llvm::LLVMContext>();
 
  	TheModule = std::make_unique<llvm::Module>("Mascal", *TheContext);
- 	//TheModule->setDataLayout(TheJIT->getDataLayout());
+
+ 	// Generated for the host, whether it's printed, optimized or emitted.
+ 	llvm::TargetMachine* machine = GetTargetMachine();
+
+ 	TheModule->setTargetTriple(machine->getTargetTriple().str());
+ 	TheModule->setDataLayout(machine->createDataLayout());
 
  	 // Create a new builder for the module.
  	Builder = std::make_unique<llvm::IRBuilder<>>(*TheContext);
 }
 
-void CodeGen::AddPHINodeToVec(llvm::PHINode* p) {
+bool CodeGen::SetOptimizationLevel(char level)
+{
+	if(level != '0' && level != '1' && level != '2' && level != '3' && level != 's' && level != 'z') {
+		return false;
+	}
 
-	CodeGen::all_phi_nodes.push_back(p);
+	optimizationLevel = level;
+	return true;
 }
 
-void CodeGen::UpdateAllPHIPreds() {
+// Made for the host on first use.
+llvm::TargetMachine* CodeGen::GetTargetMachine()
+{
+	if(TheTargetMachine != nullptr) {
+		return TheTargetMachine.get();
+	}
 
-	for(auto i : CodeGen::all_phi_nodes) {
+	llvm::InitializeNativeTarget();
+	llvm::InitializeNativeTargetAsmPrinter();
 
-		llvm::BasicBlock* parent = i->getParent();
+	std::string triple = llvm::sys::getDefaultTargetTriple();
+	std::string error;
 
-		std::vector<llvm::BasicBlock*> blockPreds;
+	const llvm::Target* target = llvm::TargetRegistry::lookupTarget(triple, error);
 
-		for (auto it = llvm::pred_begin(parent), et = llvm::pred_end(parent); it != et; ++it)
-		{
-			llvm::BasicBlock* predecessor = *it;
-			blockPreds.push_back(predecessor);
-		}
+	if(target == nullptr) {
+		std::cout << "Error: " << error << "\n";
+		exit(1);
+	}
 
-		int bCount = 0;
-		for(auto b : blockPreds) {
+	llvm::StringMap<bool> hostFeatures;
+	llvm::SubtargetFeatures features;
 
-			i->setIncomingBlock(bCount, blockPreds[bCount]);
-			bCount += 1;
+	if(llvm::sys::getHostCPUFeatures(hostFeatures)) {
+		for(auto const& i : hostFeatures) {
+			features.AddFeature(i.first(), i.second);
 		}
 	}
+
+	llvm::TargetOptions options;
+
+	TheTargetMachine.reset(target->createTargetMachine(triple, llvm::sys::getHostCPUName(), features.getString(), options, llvm::Reloc::PIC_));
+
+	return TheTargetMachine.get();
+}
+
+// Checks the module once codegen is done. Invalid IR is a compiler bug,
+// and the optimizer, the object emitter and the JIT all assume it can't
+// happen, so it stops here with what the verifier found.
+void CodeGen::Verify()
+{
+	std::string found;
+	llvm::raw_string_ostream out(found);
+
+	if(llvm::verifyModule(*TheModule, &out)) {
+
+		out.flush();
+
+		std::cout << "Error: The generated code is invalid.\n" << found;
+		exit(1);
+	}
+}
+
+// Procedures are emitted as functions and called. -O0 leaves them that way,
+// its pipeline only inlines what is marked alwaysinline. The levels above
+// run LLVM's standard pipeline for the module, inliner included.
+void CodeGen::Optimize()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	llvm::LoopAnalysisManager LAM;
+	llvm::FunctionAnalysisManager FAM;
+	llvm::CGSCCAnalysisManager CGAM;
+	llvm::ModuleAnalysisManager MAM;
+
+	// The vectorizers ask the target about its registers.
+	llvm::PassBuilder builder(GetTargetMachine());
+
+	builder.registerModuleAnalyses(MAM);
+	builder.registerCGSCCAnalyses(CGAM);
+	builder.registerFunctionAnalyses(FAM);
+	builder.registerLoopAnalyses(LAM);
+	builder.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+	llvm::ModulePassManager passes;
+
+	if(optimizationLevel == '0') { passes = builder.buildO0DefaultPipeline(llvm::OptimizationLevel::O0); }
+	else if(optimizationLevel == '1') { passes = builder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O1); }
+	else if(optimizationLevel == '2') { passes = builder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2); }
+	else if(optimizationLevel == '3') { passes = builder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3); }
+	else if(optimizationLevel == 's') { passes = builder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::Os); }
+	else if(optimizationLevel == 'z') { passes = builder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::Oz); }
+
+	passes.run(*TheModule, MAM);
+
+	if(report) {
+
+		std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - start;
+
+		std::cerr << "Optimization at -O" << optimizationLevel << " took " << took.count() << " ms.\n";
+	}
+}
+
+// Prints the module, runs it, or writes it to 'output' as an object file
+// or as an executable linked by the system's C compiler.
+void CodeGen::Emit()
+{
+	if(emit == "ir") {
+
+		TheModule->print(llvm::outs(), nullptr);
+		return;
+	}
+
+	if(emit == "run") {
+
+		Run();
+		return;
+	}
+
+	if(emit == "obj") {
+
+		EmitObject(output);
+		return;
+	}
+
+	llvm::SmallString<128> object;
+
+	if(llvm::sys::fs::createTemporaryFile("mascal", "o", object)) {
+		std::cout << "Error: Could not create a temporary object file.\n";
+		exit(1);
+	}
+
+	EmitObject(std::string(object));
+
+	Link(std::string(object), output);
+
+	llvm::sys::fs::remove(object);
+}
+
+void CodeGen::EmitObject(const std::string& path)
+{
+	llvm::TargetMachine* machine = GetTargetMachine();
+
+	machine->setOptLevel(CodeGenOptLevel());
+
+	std::error_code error;
+	llvm::raw_fd_ostream dest(path, error, llvm::sys::fs::OF_None);
+
+	if(error) {
+		std::cout << "Error: Could not open '" << path << "': " << error.message() << "\n";
+		exit(1);
+	}
+
+	// Instruction selection still runs on the legacy pass manager.
+	llvm::legacy::PassManager passes;
+
+	if(machine->addPassesToEmitFile(passes, dest, nullptr, llvm::CGFT_ObjectFile)) {
+		std::cout << "Error: The target can't emit object files.\n";
+		exit(1);
+	}
+
+	passes.run(*TheModule);
+
+	dest.flush();
+}
+
+void CodeGen::Link(const std::string& object, const std::string& path)
+{
+	llvm::ErrorOr<std::string> linker = llvm::sys::findProgramByName("cc");
+
+	if(!linker) {
+		linker = llvm::sys::findProgramByName("clang");
+	}
+
+	if(!linker) {
+		std::cout << "Error: No C compiler found to link '" << path << "'.\n";
+		exit(1);
+	}
+
+	llvm::SmallVector<llvm::StringRef, 4> args = { *linker, object, "-o", path };
+
+	std::string error;
+
+	if(llvm::sys::ExecuteAndWait(*linker, args, llvm::None, {}, 0, 0, &error) != 0) {
+		std::cout << "Error: Linking '" << path << "' failed. " << error << "\n";
+		exit(1);
+	}
+}
+
+// Compiles the module in this process and calls its main. The module and
+// its context are handed to the JIT, nothing can be generated after this.
+void CodeGen::Run()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	// These point into the module.
+	all_coms.clear();
+	all_mems.clear();
+	unsealed_blocks.clear();
+
+	auto machineBuilder = llvm::orc::JITTargetMachineBuilder::detectHost();
+
+	if(!machineBuilder) {
+		std::cout << "Error: " << llvm::toString(machineBuilder.takeError()) << "\n";
+		exit(1);
+	}
+
+	machineBuilder->setCodeGenOptLevel(CodeGenOptLevel());
+
+	auto jit = llvm::orc::LLJITBuilder().setJITTargetMachineBuilder(std::move(*machineBuilder)).create();
+
+	if(!jit) {
+		std::cout << "Error: " << llvm::toString(jit.takeError()) << "\n";
+		exit(1);
+	}
+
+	if(auto error = (*jit)->addIRModule(llvm::orc::ThreadSafeModule(std::move(TheModule), std::move(TheContext)))) {
+		std::cout << "Error: " << llvm::toString(std::move(error)) << "\n";
+		exit(1);
+	}
+
+	// Looking it up is what compiles it.
+	auto main = (*jit)->lookup("main");
+
+	if(!main) {
+		std::cout << "Error: " << llvm::toString(main.takeError()) << "\n";
+		exit(1);
+	}
+
+	auto compiled = std::chrono::steady_clock::now();
+
+	auto entry = llvm::jitTargetAddressToFunction<int (*)()>(main->getAddress());
+
+	exitCode = entry();
+
+	auto executed = std::chrono::steady_clock::now();
+
+	if(report) {
+
+		std::chrono::duration<double, std::milli> compiling = compiled - start;
+		std::chrono::duration<double, std::milli> executing = executed - compiled;
+
+		std::cerr << "JIT compile took " << compiling.count() << " ms, execution took " << executing.count() << " ms.\n";
+	}
+}
+
+llvm::CodeGenOpt::Level CodeGen::CodeGenOptLevel()
+{
+	if(optimizationLevel == '0') { return llvm::CodeGenOpt::None; }
+	if(optimizationLevel == '1') { return llvm::CodeGenOpt::Less; }
+	if(optimizationLevel == '3') { return llvm::CodeGenOpt::Aggressive; }
+
+	return llvm::CodeGenOpt::Default;
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -44,14 +45,30 @@
 #include "llvm/Transforms/IPO/AlwaysInliner.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/IR/CFG.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/Path.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include <chrono>
+#include <iostream>
 #include <unordered_map>
+#include "Symbols.hpp"
 
 struct LLVM_Com {
 
 	llvm::Value* origin;
-	llvm::Value* current;
 
-	std::unordered_map<std::string, llvm::Value*> states;
+	llvm::Type* ty;
+
+	// The value the com has at the end of each block that has been asked
+	// about so far. Handles follow a PHI to whatever replaced it.
+	llvm::DenseMap<llvm::BasicBlock*, llvm::WeakTrackingVH> states;
 };
 
 struct LLVM_Mem {
@@ -60,27 +77,55 @@ struct LLVM_Mem {
 	llvm::Value* current;
 
 	llvm::Type* ty;
-
-	std::unordered_map<std::string, llvm::Value*> states;
 };
 
 struct CodeGen {
 
-	static bool releaseMode;
+	// Set by 'build -O0' to '-O3', '-Os' and '-Oz'.
+	static char optimizationLevel;
 
-	static std::unordered_map<std::string, std::unique_ptr<LLVM_Com>> all_coms;
-	static std::unordered_map<std::string, std::unique_ptr<LLVM_Mem>> all_mems;
+	// Set by 'build --stats'.
+	static bool report;
 
-	static std::vector<llvm::PHINode*> all_phi_nodes;
+	// What 'build' makes, "ir", "obj" or "exe", and where it's written.
+	// Set by '--emit=' and '-o'. 'run' sets "run".
+	static std::string emit;
+	static std::string output;
 
-	static void AddPHINodeToVec(llvm::PHINode* p);
-	static void UpdateAllPHIPreds();
+	// What the program's main returned, when it was run.
+	static int exitCode;
+
+	// Keyed by symbol, in declaration order.
+	static llvm::MapVector<Symbol, std::unique_ptr<LLVM_Com>> all_coms;
+	static llvm::MapVector<Symbol, std::unique_ptr<LLVM_Mem>> all_mems;
+
+	// Blocks that may still get predecessors, a loop's first block until its
+	// body is done, with the PHIs that wait for their operands.
+	static llvm::DenseMap<llvm::BasicBlock*, llvm::MapVector<Symbol, llvm::PHINode*>> unsealed_blocks;
 
 	static std::unique_ptr<llvm::LLVMContext> TheContext;
 	static std::unique_ptr<llvm::IRBuilder<>> Builder;
 	static std::unique_ptr<llvm::Module> TheModule;
 
+	static std::unique_ptr<llvm::TargetMachine> TheTargetMachine;
+
 	static void Initialize();
+
+	static bool SetOptimizationLevel(char level);
+
+	static llvm::TargetMachine* GetTargetMachine();
+
+	static void Verify();
+
+	static void Optimize();
+
+	static void Emit();
+	static void EmitObject(const std::string& path);
+	static void Link(const std::string& object, const std::string& path);
+
+	static void Run();
+
+	static llvm::CodeGenOpt::Level CodeGenOptLevel();
 };
 
 #endif
\ No newline at end of file
@@ -2,50 +2,199 @@
 #define LEXER_HPP
 
 #include <string>
+#include <string_view>
+#include <charconv>
 #include <iostream>
 #include <vector>
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <cstdint>
+#include "llvm/Support/MemoryBuffer.h"
+#include "Scanner.hpp"
+#include "Symbols.hpp"
 //#include "ErrorHandler.hpp"
 
+// The single list of keywords. Each entry becomes a Token and a slot
+// in the keyword hash table used by Lexer::GetIdentifier.
+#define MASCAL_KEYWORDS(X) \
+	X(Program, "program") \
+	X(Begin, "begin") \
+	X(End, "end") \
+	X(Com, "com") \
+	X(LLReturn, "llreturn") \
+	X(Add, "add") \
+	X(Sub, "sub") \
+	X(Compare, "COMPARE") \
+	X(If, "if") \
+	X(Then, "then") \
+	X(Else, "else") \
+	X(Return, "return") \
+	X(Procedure, "proc") \
+	X(ComStore, "comstore") \
+	X(Mem, "mem") \
+	X(LoadMem, "loadmem") \
+	X(MemStore, "memstore") \
+	X(IntCast, "intcast") \
+	X(To, "to") \
+	X(While, "while") \
+	X(Do, "do")
+
+enum KeywordIndex
+{
+#define MASCAL_KEYWORD_INDEX(tok, text) Keyword##tok,
+	MASCAL_KEYWORDS(MASCAL_KEYWORD_INDEX)
+#undef MASCAL_KEYWORD_INDEX
+
+	KeywordCount
+};
+
 enum Token
 {
 	EndOfFile = -1,
-	Program = -2,
-	Begin = -3,
-	End = -4,
 
-	String = -5,
-	Number = -6,
+	String = -2,
+	Number = -3,
+
+	Identifier = -4,
+
+	FirstKeyword = -5,
+
+#define MASCAL_KEYWORD_TOKEN(tok, text) tok = FirstKeyword - Keyword##tok,
+	MASCAL_KEYWORDS(MASCAL_KEYWORD_TOKEN)
+#undef MASCAL_KEYWORD_TOKEN
+};
+
+// Perfect hash over MASCAL_KEYWORDS, searched at compile time.
+// An identifier costs one hash and at most one string compare.
+struct KeywordHash
+{
+	static constexpr std::string_view Texts[KeywordCount] = {
+#define MASCAL_KEYWORD_TEXT(tok, text) text,
+		MASCAL_KEYWORDS(MASCAL_KEYWORD_TEXT)
+#undef MASCAL_KEYWORD_TEXT
+	};
+
+	static constexpr uint32_t TableSize = 64;
+
+	// Only looks at the length and three characters, so the cost doesn't
+	// grow with the identifier.
+	static constexpr uint32_t Hash(std::string_view s, uint32_t seed)
+	{
+		uint32_t h = (uint32_t)s.size();
+
+		h = h * seed + (uint8_t)s[0];
+		h = h * seed + (uint8_t)s[s.size() - 1];
+		h = h * seed + (uint8_t)s[s.size() / 2];
+
+		return (h ^ (h >> 11)) & (TableSize - 1);
+	}
+
+	struct Layout
+	{
+		uint32_t seed = 0;
+		std::array<int8_t, TableSize> slots {};
+	};
+
+	static constexpr Layout FindLayout()
+	{
+		for (uint32_t seed = 1; seed < 100000; seed++)
+		{
+			Layout layout;
+			layout.seed = seed;
+			layout.slots.fill(-1);
+
+			bool collision = false;
+
+			for (int i = 0; i < KeywordCount && !collision; i++)
+			{
+				uint32_t slot = Hash(Texts[i], seed);
+
+				if (layout.slots[slot] != -1) collision = true;
+				else layout.slots[slot] = (int8_t)i;
+			}
+
+			if (!collision) return layout;
+		}
+
+		return Layout {};
+	}
+
+	static constexpr size_t MinLength()
+	{
+		size_t len = Texts[0].size();
+		for (auto t : Texts) if (t.size() < len) len = t.size();
+		return len;
+	}
+
+	static constexpr size_t MaxLength()
+	{
+		size_t len = 0;
+		for (auto t : Texts) if (t.size() > len) len = t.size();
+		return len;
+	}
+};
 
-	Identifier = -7,
+struct Keywords
+{
+	static constexpr KeywordHash::Layout Table = KeywordHash::FindLayout();
+	static constexpr size_t MinLength = KeywordHash::MinLength();
+	static constexpr size_t MaxLength = KeywordHash::MaxLength();
 
-	Com = -8,
+	static_assert(Table.seed != 0, "No perfect hash for MASCAL_KEYWORDS, grow KeywordHash::TableSize.");
 
-	LLReturn = -9,
+	static constexpr int Lookup(std::string_view s)
+	{
+		if (s.size() < MinLength || s.size() > MaxLength) return Token::Identifier;
 
-	Add = -10,
-	Sub = -11,
+		int index = Table.slots[KeywordHash::Hash(s, Table.seed)];
 
-	Compare = -12,
+		if (index < 0 || KeywordHash::Texts[index] != s) return Token::Identifier;
 
-	If = -13,
-	Then = -14,
-	Else = -15,
+		return FirstKeyword - index;
+	}
+};
 
-	Return = -16,
+static_assert(Keywords::Lookup("while") == Token::While);
+static_assert(Keywords::Lookup("whale") == Token::Identifier);
 
-	Procedure = -17,
+// Struct-of-arrays token stream filled by Lexer::Tokenize. The parser walks it
+// by index, so looking ahead is reading a later slot.
+struct TokenBuffer
+{
+	std::vector<int16_t> Kinds;
+	std::vector<uint32_t> Offsets;
+	std::vector<uint32_t> Lengths;
 
-	ComStore = -18,
+	// Interned name for identifiers, Symbols::None for everything else.
+	std::vector<Symbol> SymbolIds;
 
-	Mem = -19,
-	LoadMem = -20,
-	MemStore = -21,
+	size_t Size() const { return Kinds.size(); }
 
-	IntCast = -22,
-	To = -23,
+	void Reserve(size_t count)
+	{
+		Kinds.reserve(count);
+		Offsets.reserve(count);
+		Lengths.reserve(count);
+		SymbolIds.reserve(count);
+	}
+
+	void Clear()
+	{
+		Kinds.clear();
+		Offsets.clear();
+		Lengths.clear();
+		SymbolIds.clear();
+	}
 
-	While = -24,
-	Do = -25,
+	void Push(int kind, uint32_t offset, uint32_t length, Symbol symbol)
+	{
+		Kinds.push_back((int16_t)kind);
+		Offsets.push_back(offset);
+		Lengths.push_back(length);
+		SymbolIds.push_back(symbol);
+	}
 };
 
 enum LexerIsInside {
@@ -53,91 +202,203 @@ enum LexerIsInside {
 	AProcedure
 };
 
+// Lexer state lives in the instance, so each source gets its own Lexer
+// and several of them can run at once on different threads.
 struct Lexer
 {
-	static std::string Content;
+	Lexer() = default;
+
+	// Content may point into OwnedContent, so a Lexer stays where it was built.
+	Lexer(const Lexer&) = delete;
+	Lexer& operator=(const Lexer&) = delete;
+
+	// View of the source being lexed. It either points into OwnedContent
+	// (AddContent) or straight into the file mapping (OpenFile).
+	std::string_view Content;
 
-	static std::string IdentifierStr;
-	static std::string NumValString;
-	static std::string StringString;
+	std::string OwnedContent;
+	std::unique_ptr<llvm::MemoryBuffer> MappedContent;
 
-	static void AddContent(std::string c)
+	// Token texts are slices of Content, they stay valid as long as the source does.
+	std::string_view IdentifierStr;
+	std::string_view NumValString;
+
+	// Scratch storage for char literals, their value can't be sliced from
+	// the source. Reused between tokens.
+	char CharBuffer[8] = {};
+
+	void AddContent(std::string c)
 	{
-		Content += c;
+		OwnedContent += c;
+		Content = OwnedContent;
 	}
 
-	static int CurrentToken;
-	static int Position;
+	// Maps the file into memory instead of reading it into a string,
+	// so the source is never copied before lexing. "-" reads stdin whole.
+	bool OpenFile(const std::string& path)
+	{
+		auto buffer = llvm::MemoryBuffer::getFileOrSTDIN(path, /*IsText*/ false, /*RequiresNullTerminator*/ false);
 
-	static int Line;
-	static int Column;
+		if (!buffer) return false;
 
-	static std::string line_as_string;
+		MappedContent = std::move(buffer.get());
+		Content = std::string_view(MappedContent->getBufferStart(), MappedContent->getBufferSize());
+
+		return true;
+	}
 
-	static std::vector<std::string> all_lines_vector;
+	int CurrentToken = 0;
+	int Position = -1;
 
-	static LexerIsInside isInside;
+	// Byte offset of the first character of CurrentToken.
+	int TokenStart = 0;
 
-	static void Start()
+	// Offset of the first byte of every line. Lexing only tracks offsets,
+	// this table is built the first time a diagnostic asks for a line.
+	std::vector<int> LineStarts;
+
+	void Start()
 	{
 		Position = -1;
-		Line = 1;
-		Column = 1;
+		TokenStart = 0;
 		LastChar = ' ';
+
+		LineStarts.clear();
 	}
 
-	static int Advance()
+	int Advance()
 	{
 		Position += 1;
 
-		Column += 1;
+		if (Position >= (int)Content.size()) return EOF;
 
-		line_as_string += Content[Position];
+		return Content[Position];
+	}
 
-		if (Content[Position] == '\n')
-		{
-			Line += 1;
-			Column = 1;
+	// Jumps to an offset found by the Scanner and loads its character.
+	void Seek(int offset)
+	{
+		Position = offset;
+		LastChar = Position < (int)Content.size() ? Content[Position] : EOF;
+	}
+
+	void BuildLineIndex()
+	{
+		if (!LineStarts.empty()) return;
+
+		LineStarts.push_back(0);
 
-			all_lines_vector.push_back(line_as_string);
+		const char* begin = Content.data();
+		const char* end = begin + Content.size();
+		const char* p = begin;
 
-			line_as_string.clear();
+		// memchr is vectorized by the C library, much faster than a byte loop.
+		while ((p = (const char*)memchr(p, '\n', end - p)) != nullptr)
+		{
+			p += 1;
+			LineStarts.push_back((int)(p - begin));
 		}
+	}
 
-		return Content[Position];
+	// 1-based line and column of a byte offset.
+	void GetLocation(int offset, int& line, int& column)
+	{
+		BuildLineIndex();
+
+		auto it = std::upper_bound(LineStarts.begin(), LineStarts.end(), offset);
+
+		line = (int)(it - LineStarts.begin());
+		column = offset - LineStarts[line - 1] + 1;
 	}
 
-	static void GetNextToken()
+	std::string_view GetLineText(int line)
+	{
+		BuildLineIndex();
+
+		if (line < 1 || line > (int)LineStarts.size()) return {};
+
+		int start = LineStarts[line - 1];
+		int end = line < (int)LineStarts.size() ? LineStarts[line] : (int)Content.size();
+
+		std::string_view text = Content.substr(start, end - start);
+
+		while (!text.empty() && (text.back() == '\n' || text.back() == '\r'))
+			text.remove_suffix(1);
+
+		return text;
+	}
+
+	void GetNextToken()
 	{
 		CurrentToken = GetToken();
 	}
 
-	static int LastChar;
+	// Every token of the source, ending with Token::EndOfFile.
+	TokenBuffer Tokens;
 
-	static int GetToken()
+	// Lexes the whole source into Tokens in one pass.
+	void Tokenize()
 	{
-		while (isspace(LastChar)) LastChar = Advance();
+		Start();
 
-		if (isalpha(LastChar) || LastChar == '@') return GetIdentifier();
+		Tokens.Clear();
+		Tokens.Reserve(Content.size() / 8 + 1);
 
-		if (isdigit(LastChar)) return GetNumber();
+		// Names seen in this file, so the shared table is only locked once per name.
+		llvm::StringMap<Symbol> fileSymbols;
 
-		if(LastChar == '\'') return GetChar();
+		do
+		{
+			GetNextToken();
 
-		if(LastChar == '\"') return GetString();
+			Symbol symbol = Symbols::None;
 
-		if (LastChar == '#')
-		{
-			// Comment until end of line.
-			do
+			int length = CurrentToken == Token::EndOfFile ? 0 : Position - TokenStart;
+
+			if (CurrentToken == Token::Identifier)
 			{
-				LastChar = Advance();
+				llvm::StringRef key(IdentifierStr.data(), IdentifierStr.size());
+				auto found = fileSymbols.find(key);
+
+				if (found != fileSymbols.end()) symbol = found->second;
+				else symbol = fileSymbols[key] = Symbols::Intern(IdentifierStr);
 			}
-			while (LastChar != EOF && LastChar != '\n' && LastChar != '\r');
 
-			if (LastChar != EOF) return GetToken();
+			Tokens.Push(CurrentToken, TokenStart, length, symbol);
+
+		} while (CurrentToken != Token::EndOfFile);
+	}
+
+	std::string_view TokenText(size_t index) const
+	{
+		return Content.substr(Tokens.Offsets[index], Tokens.Lengths[index]);
+	}
+
+	int LastChar = ' ';
+
+	int GetToken()
+	{
+		// Whitespace runs and comments are skipped whole, in one loop.
+		while (true)
+		{
+			if (isspace(LastChar)) Seek(Scanner::SkipWhitespace(Content, Position + 1));
+
+			// Comment until end of line.
+			else if (LastChar == '#') Seek(Scanner::SkipComment(Content, Position + 1));
+
+			else break;
 		}
 
+		TokenStart = Position;
+
+		if (isalpha(LastChar) || LastChar == '@') return GetIdentifier();
+
+		if (isdigit(LastChar)) return GetNumber();
+
+		if(LastChar == '\'') return GetChar();
+
+		if(LastChar == '\"') return GetString();
+
 		if (LastChar == EOF) return Token::EndOfFile;
 
 		int ThisChar = LastChar;
@@ -153,31 +414,30 @@ struct Lexer
 		return ThisChar;
 	}
 
-	static bool IsIdentifier(std::string s)
+	bool IsIdentifier(std::string_view s)
 	{
 		return IdentifierStr == s;
 	}
 
-	static bool is_still_identifier(char c)
+	bool is_still_identifier(char c)
 	{
 		return isalnum(c) || c == '_';
 	}
 
 	//static void throw_identifier_syntax_warning(std::string message, std::string recommendation)
 	//{
-	//	ErrorHandler::print(message, Lexer::Line, Lexer::Column, Lexer::line_as_string, 1, recommendation);
+	//	ErrorHandler::print(message, line, column, GetLineText(line), 1, recommendation);
 	//}
 
-	static int GetChar()
+	int GetChar()
 	{
 		LastChar = Advance();
 
-		NumValString = "";
-
 		if(LastChar == '\\')
 			StringSlash();
 
-		NumValString += std::to_string(LastChar);
+		auto result = std::to_chars(CharBuffer, CharBuffer + sizeof(CharBuffer), LastChar);
+		NumValString = std::string_view(CharBuffer, result.ptr - CharBuffer);
 
 		LastChar = Advance();
 
@@ -186,17 +446,16 @@ struct Lexer
 		return Token::Number;
 	}
 
-	static int GetString()
+	int GetString()
 	{
-		StringString = "";
 		LastChar = Advance();
 
+		// Nothing reads the string's value, its text is the token's slice.
+		// Escapes are still stepped over so '\"' doesn't end it.
 		do
 		{
-			if(LastChar == '\\')
-				StringSlash();
+			if(LastChar == '\\') StringSlash();
 
-			StringString += LastChar;
 			LastChar = Advance();
 		} while(LastChar != '\"' && LastChar != Token::EndOfFile && LastChar >= 32);
 
@@ -205,74 +464,63 @@ struct Lexer
 		return Token::String;
 	}
 
-	static void StringSlash()
+	void StringSlash()
 	{
-		LastChar = Advance();
-
-		if(LastChar == 'n') LastChar = '\n';
-		else if(LastChar == 'r') LastChar = '\r';
-		else if(LastChar == 't') LastChar = '\t';
-		else if(LastChar == '0') LastChar = '\0';
-		else if(LastChar == '\"') LastChar = '\"';
-		else if(LastChar == '\\') LastChar = '\\';
+		LastChar = EscapeValue(Advance());
 	}
 
-	static int GetIdentifier()
+	// The character an escape like '\n' stands for.
+	static int EscapeValue(int c)
 	{
-		IdentifierStr = LastChar;
-
-		while (is_still_identifier((LastChar = Advance())))
-		{
-			IdentifierStr += LastChar;
-		}
-
-		if (IsIdentifier("program")) return Token::Program;
-		else if(IsIdentifier("begin")) return Token::Begin;
-		else if(IsIdentifier("end")) return Token::End;
-
-		else if(IsIdentifier("com")) return Token::Com;
-
-		else if(IsIdentifier("llreturn")) return Token::LLReturn;
-
-		else if(IsIdentifier("add")) return Token::Add;
-		else if(IsIdentifier("sub")) return Token::Sub;
-
-		else if(IsIdentifier("COMPARE")) return Token::Compare;
-
-		else if(IsIdentifier("if")) return Token::If;
-		else if(IsIdentifier("then")) return Token::Then;
-		else if(IsIdentifier("else")) return Token::Else;
-
-		else if(IsIdentifier("return")) return Token::Return;
+		if(c == 'n') return '\n';
+		else if(c == 'r') return '\r';
+		else if(c == 't') return '\t';
+		else if(c == '0') return '\0';
+		else if(c == '\"') return '\"';
+		else if(c == '\\') return '\\';
+
+		return c;
+	}
 
-		else if(IsIdentifier("proc")) return Token::Procedure;
+	// Value of a char literal from its source text, quotes included.
+	static int CharLiteralValue(std::string_view text)
+	{
+		if(text.size() < 2) return 0;
 
-		else if(IsIdentifier("comstore")) return Token::ComStore;
+		if(text[1] == '\\' && text.size() > 2) return EscapeValue(text[2]);
 
-		else if(IsIdentifier("mem")) return Token::Mem;
-		else if(IsIdentifier("loadmem")) return Token::LoadMem;
-		else if(IsIdentifier("memstore")) return Token::MemStore;
+		return text[1];
+	}
 
-		else if(IsIdentifier("intcast")) return Token::IntCast;
-		else if(IsIdentifier("to")) return Token::To;
+	int GetIdentifier()
+	{
+		Seek(Scanner::SkipIdentifier(Content, Position + 1));
 
-		else if(IsIdentifier("while")) return Token::While;
-		else if(IsIdentifier("do")) return Token::Do;
+		IdentifierStr = Content.substr(TokenStart, Position - TokenStart);
 
-		return Token::Identifier;
+		return Keywords::Lookup(IdentifierStr);
 	}
 
-	static int GetNumber()
+	int GetNumber()
 	{
-		std::string NumStr;
+		bool zero = LastChar == '0';
+		int prefix = zero ? Advance() : EOF;
 
-		do
+		// '0x' and '0b' literals run over hex digits, the parser checks them
+		// against the radix. The text keeps its '_' separators.
+		if (prefix == 'x' || prefix == 'X' || prefix == 'b' || prefix == 'B')
 		{
-			if(LastChar != '_') NumStr += LastChar;
-			LastChar = Advance();
-		} while (isdigit(LastChar) || LastChar == '.' || LastChar == 'f' || LastChar == '_');
+			Seek(Scanner::SkipHexNumber(Content, Position + 1));
+		}
+		else
+		{
+			if (zero) Seek(Position - 1);
+
+			Seek(Scanner::SkipNumber(Content, Position + 1));
+		}
+
+		NumValString = Content.substr(TokenStart, Position - TokenStart);
 
-		NumValString = NumStr;
 		return Token::Number;
 	}
 };
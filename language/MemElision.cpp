@@ -0,0 +1,7 @@
+#include "MemElision.hpp"
+
+std::atomic<uint64_t> MemElision::removed_loads = 0;
+std::atomic<uint64_t> MemElision::removed_stores = 0;
+std::atomic<uint64_t> MemElision::removed_nodes = 0;
+
+bool MemElision::report = false;
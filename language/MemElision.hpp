@@ -0,0 +1,296 @@
+#ifndef MEM_ELISION_HPP
+#define MEM_ELISION_HPP
+
+#include <iostream>
+#include "AST.hpp"
+
+// The parser reads a mem through '_loadN' coms: it's loaded before its first
+// read and stored back, then loaded again, whenever it's read after a write.
+// This pass walks a body in the order codegen will, turns loads whose value
+// is still in a com into plain copies of that com and drops stores that are
+// overwritten before anything reads them.
+// An 'if' or 'while' ends everything known so far, their bodies are handled
+// on their own. Runs right after parsing.
+struct MemElision {
+
+	static std::atomic<uint64_t> removed_loads;
+	static std::atomic<uint64_t> removed_stores;
+	static std::atomic<uint64_t> removed_nodes;
+
+	// Set by 'build --stats'.
+	static bool report;
+
+	typedef AST::Vector<AST::Owned<AST::Expression>> Body;
+
+	// A store, and the list it can be removed from. The list is null when
+	// the store isn't a direct element of one.
+	struct Store {
+
+		Body* list = nullptr;
+		AST::Expression* store = nullptr;
+	};
+
+	struct State {
+
+		// Every mem declared so far. A variable naming one isn't a com.
+		llvm::SmallDenseSet<Symbol, 8> mems;
+
+		// The com holding the value each mem has in memory.
+		llvm::DenseMap<Symbol, Symbol> values;
+
+		// The last store to each mem, for as long as nothing read it.
+		llvm::DenseMap<Symbol, Store> unread;
+
+		std::vector<Store> dead;
+	};
+
+	static void Run(AST::Procedure* proc) {
+
+		State state;
+		Walk(proc->body, state, true);
+	}
+
+	static void Run(AST::Program* program) {
+
+		State state;
+		Walk(program->all_instructions, state, true);
+	}
+
+	static void Report() {
+
+		if(report) {
+			std::cerr << "Mem elision: removed " << removed_loads << " loads and " << removed_stores << " stores (" << removed_nodes << " nodes).\n";
+		}
+	}
+
+	static void Walk(Body& body, State& state, bool outermost) {
+
+		VisitAll(body, state);
+
+		// Mems live on the stack, nothing reads them once the function returned.
+		if(outermost) {
+			for(auto const& i : state.unread) {
+				state.dead.push_back(i.second);
+			}
+		}
+
+		for(auto const& i : state.dead) {
+			Remove(i);
+		}
+	}
+
+	static void Visit(AST::Expression* e, Body* list, State& state) {
+
+		if(auto v = llvm::dyn_cast<AST::Variable>(e)) {
+
+			for(auto const& i : v->initializers) {
+				Visit(i.get(), &v->initializers, state);
+			}
+
+			state.unread.erase(v->name);
+			return;
+		}
+
+		if(auto c = llvm::dyn_cast<AST::Com>(e)) {
+
+			VisitCom(c, state);
+			return;
+		}
+
+		if(auto store = llvm::dyn_cast<AST::MemStore>(e)) {
+
+			VisitMemStore(store, list, state);
+			return;
+		}
+
+		if(auto m = llvm::dyn_cast<AST::Mem>(e)) {
+
+			Visit(m->target.get(), nullptr, state);
+
+			state.mems.insert(m->name);
+			state.unread.erase(m->name);
+			SetValue(m->name, m->target.get(), state);
+			return;
+		}
+
+		if(auto w = llvm::dyn_cast<AST::While>(e)) {
+
+			VisitAll(w->mem_stores, state);
+			Barrier(state);
+			Nested(w->loop_body, state);
+			return;
+		}
+
+		if(auto i = llvm::dyn_cast<AST::If>(e)) {
+
+			VisitAll(i->mem_stores, state);
+			Barrier(state);
+			Nested(i->if_body, state);
+			Nested(i->else_body, state);
+			return;
+		}
+
+		e->ForEachChild([&](AST::Expression* child) {
+			Visit(child, nullptr, state);
+		});
+
+		// These write the com they're applied to.
+		if(auto add = llvm::dyn_cast<AST::Add>(e)) Overwritten(add->target->name, state);
+		else if(auto sub = llvm::dyn_cast<AST::Sub>(e)) Overwritten(sub->target->name, state);
+		else if(auto store = llvm::dyn_cast<AST::ComStore>(e)) Overwritten(store->target->name, state);
+	}
+
+	static void VisitAll(Body& body, State& state) {
+
+		for(auto const& e : body) {
+			Visit(e.get(), &body, state);
+		}
+	}
+
+	static void VisitCom(AST::Com* c, State& state) {
+
+		auto load = llvm::dyn_cast<AST::LoadMem>(c->target.get());
+
+		if(load == nullptr) {
+
+			Visit(c->target.get(), nullptr, state);
+			Overwritten(c->name, state);
+			return;
+		}
+
+		Symbol mem = load->target->name;
+		auto known = state.values.find(mem);
+
+		if(known != state.values.end()) {
+
+			removed_loads += 1;
+			removed_nodes += Count(c->target.get()) - 1;
+
+			c->target = AST::New<AST::Variable>(known->second);
+
+			Overwritten(c->name, state);
+			return;
+		}
+
+		Visit(c->target.get(), nullptr, state);
+		Overwritten(c->name, state);
+
+		state.values[mem] = c->name;
+	}
+
+	static void VisitMemStore(AST::MemStore* store, Body* list, State& state) {
+
+		Visit(store->value.get(), nullptr, state);
+
+		Symbol mem = store->target->name;
+		auto previous = state.unread.find(mem);
+
+		if(previous != state.unread.end()) {
+			state.dead.push_back(previous->second);
+		}
+
+		// A store whose value defines coms can't go, later code may use them.
+		if(Removable(store->value.get())) {
+			state.unread[mem] = { list, store };
+		}
+		else {
+			state.unread.erase(mem);
+		}
+
+		SetValue(mem, store->value.get(), state);
+	}
+
+	static void SetValue(Symbol mem, AST::Expression* value, State& state) {
+
+		auto v = llvm::dyn_cast<AST::Variable>(value);
+
+		if(v != nullptr && !state.mems.count(v->name)) {
+			state.values[mem] = v->name;
+		}
+		else {
+			state.values.erase(mem);
+		}
+	}
+
+	// 'com' changed, mems no longer hold its value.
+	static void Overwritten(Symbol com, State& state) {
+
+		llvm::SmallVector<Symbol, 4> stale;
+
+		for(auto const& i : state.values) {
+			if(i.second == com) {
+				stale.push_back(i.first);
+			}
+		}
+
+		for(Symbol s : stale) {
+			state.values.erase(s);
+		}
+	}
+
+	// Stores before the block stay, the block may read them.
+	static void Barrier(State& state) {
+
+		state.values.clear();
+		state.unread.clear();
+	}
+
+	static void Nested(Body& body, State& outer) {
+
+		State state;
+		state.mems = outer.mems;
+
+		Walk(body, state, false);
+	}
+
+	static bool Removable(AST::Expression* e) {
+
+		if(auto v = llvm::dyn_cast<AST::Variable>(e)) {
+			return v->initializers.empty();
+		}
+
+		if(llvm::isa<AST::Com, AST::Mem, AST::Call>(e)) {
+			return false;
+		}
+
+		bool removable = true;
+
+		e->ForEachChild([&](AST::Expression* child) {
+			removable = removable && Removable(child);
+		});
+
+		return removable;
+	}
+
+	static void Remove(const Store& s) {
+
+		if(s.list == nullptr) {
+			return;
+		}
+
+		for(auto it = s.list->begin(); it != s.list->end(); ++it) {
+
+			if(it->get() == s.store) {
+
+				removed_stores += 1;
+				removed_nodes += Count(s.store);
+
+				s.list->erase(it);
+				return;
+			}
+		}
+	}
+
+	static uint64_t Count(AST::Expression* e) {
+
+		uint64_t count = 1;
+
+		e->ForEachChild([&](AST::Expression* child) {
+			count += Count(child);
+		});
+
+		return count;
+	}
+};
+
+#endif
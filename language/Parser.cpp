@@ -1,13 +1,27 @@
 #include "Parser.hpp"
 
-std::string Parser::main_target;
-bool Parser::can_main_target_be_modified;
+thread_local Lexer* Parser::source = nullptr;
+thread_local size_t Parser::token_index = 0;
 
-std::unordered_map<std::string, AST::Type*> Parser::all_parser_coms;
-std::unordered_map<std::string, std::unique_ptr<Parser_Mem>> Parser::all_parser_mems;
+thread_local LexerIsInside Parser::isInside = LexerIsInside::AProgram;
 
-std::vector<std::unique_ptr<AST::Procedure>> Parser::all_procedures;
+thread_local Symbol Parser::main_target = Symbols::None;
+thread_local bool Parser::can_main_target_be_modified;
 
-std::string Parser::current_procedure_name;
+thread_local llvm::DenseMap<Symbol, AST::Type*> Parser::all_parser_coms;
+thread_local llvm::DenseMap<Symbol, std::unique_ptr<Parser_Mem>> Parser::all_parser_mems;
 
-AST::Attributes Parser::currentAttributes;
\ No newline at end of file
+std::vector<AST::Owned<AST::Procedure>> Parser::all_procedures;
+
+llvm::DenseMap<Symbol, Parser_Procedure> Parser::procedure_index;
+
+std::vector<Symbol> Parser::requested_bodies;
+std::mutex Parser::requested_lock;
+thread_local llvm::DenseMap<Symbol, AST::Type*> Parser::current_argument_types;
+
+thread_local Symbol Parser::current_procedure_name = Symbols::None;
+
+thread_local AST::Attributes Parser::currentAttributes;
+
+std::mutex Parser::error_lock;
+bool Parser::error_reported = false;
\ No newline at end of file
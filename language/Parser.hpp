@@ -2,10 +2,13 @@
 #define PARSER_HPP
 
 #include <iostream>
-#include <fstream>
 #include <cstdlib>
+#include <chrono>
+#include <thread>
 #include "Lexer.hpp"
 #include "AST.hpp"
+#include "MemElision.hpp"
+#include "ThreadPool.hpp"
 
 struct Parser_Mem {
 
@@ -13,29 +16,127 @@ struct Parser_Mem {
 	bool is_verified = true;
 
 	int loadCount = 0;
-	std::string loadVariableName = "";
+	Symbol loadVariable = Symbols::None;
+};
+
+// An infix operator at the current token. Precedence 0 means there's none.
+struct Parser_Operator {
+
+	int precedence = 0;
+
+	// An AST::BinaryType, or an AST::CompareType when 'compare' is set.
+	int kind = 0;
+	bool compare = false;
+
+	// Tokens it's made of, '<<' and '<=' are two.
+	int length = 1;
+};
+
+struct Parser_Procedure {
+
+	AST::Procedure* proc = nullptr;
+
+	// Where the body is. It's parsed once the first call to it is.
+	Lexer* source = nullptr;
+	size_t begin = 0;
+	size_t end = 0;
 };
 
 struct Parser {
 
-	static std::string main_target;
-	static bool can_main_target_be_modified;
+	// The file being parsed and its position in the token buffer. Like the
+	// rest of the state of a single parse these are per thread, procedure
+	// bodies are parsed on several at once.
+	static thread_local Lexer* source;
+	static thread_local size_t token_index;
+
+	static thread_local LexerIsInside isInside;
+
+	static void SetSource(Lexer* lexer) {
+
+		source = lexer;
+		token_index = 0;
+	}
+
+	static int CurrentToken() {
+
+		return source->Tokens.Kinds[token_index];
+	}
+
+	// Token 'ahead' slots after the current one, EndOfFile past the end.
+	static int PeekToken(size_t ahead = 1) {
+
+		size_t last = source->Tokens.Size() - 1;
+
+		return source->Tokens.Kinds[std::min(token_index + ahead, last)];
+	}
+
+	static void NextToken() {
 
-	static std::string current_procedure_name;
+		if(token_index + 1 < source->Tokens.Size()) {
+			token_index += 1;
+		}
+	}
+
+	static std::string_view TokenText() {
+
+		return source->TokenText(token_index);
+	}
+
+	// Identifiers come interned from the lexer, any other token is interned here.
+	static Symbol TokenSymbol() {
 
-	static std::vector<std::unique_ptr<AST::Procedure>> all_procedures;
+		Symbol s = source->Tokens.SymbolIds[token_index];
+
+		return s != Symbols::None ? s : Symbols::Intern(TokenText());
+	}
+
+	// Names the parser makes up ('x_load1', 'proc_return') are symbols too.
+	static Symbol Suffixed(Symbol base, std::string suffix) {
+
+		return Symbols::Intern(std::string(Symbols::Name(base)) + suffix);
+	}
 
-	static std::unordered_map<std::string, AST::Type*> all_parser_coms;
-	static std::unordered_map<std::string, std::unique_ptr<Parser_Mem>> all_parser_mems;
+	static thread_local Symbol main_target;
+	static thread_local bool can_main_target_be_modified;
 
-	static AST::Attributes currentAttributes;
+	static thread_local Symbol current_procedure_name;
 
-	static void AddParserCom(std::string name, AST::Type* t) {
+	// Shared by all threads. Only written while no bodies are being parsed.
+	static std::vector<AST::Owned<AST::Procedure>> all_procedures;
+	static llvm::DenseMap<Symbol, Parser_Procedure> procedure_index;
+
+	// Procedures called for the first time, whose bodies still need parsing.
+	static std::vector<Symbol> requested_bodies;
+	static std::mutex requested_lock;
+
+	// Argument types of the procedure being parsed.
+	static thread_local llvm::DenseMap<Symbol, AST::Type*> current_argument_types;
+
+	static thread_local llvm::DenseMap<Symbol, AST::Type*> all_parser_coms;
+	static thread_local llvm::DenseMap<Symbol, std::unique_ptr<Parser_Mem>> all_parser_mems;
+
+	static thread_local AST::Attributes currentAttributes;
+
+	static std::mutex error_lock;
+	static bool error_reported;
+
+	// Forgets every com, mem and argument, a procedure starts with none.
+	static void ResetScope() {
+
+		all_parser_coms.clear();
+		all_parser_mems.clear();
+		current_argument_types.clear();
+
+		StartMainTargetSystem();
+	}
+
+	static void AddParserCom(Symbol name, AST::Type* t) {
 
 		all_parser_coms[name] = t;
 	}
 
-	static void AddParserMem(std::string name, AST::Type* t) {
+	static void AddParserMem(Symbol name, AST::Type* t) {
 
 		auto pMem = std::make_unique<Parser_Mem>();
 
@@ -43,58 +144,51 @@ struct Parser {
 		pMem->is_verified = true;
 		
 		pMem->loadCount = 0;
-		pMem->loadVariableName = "";
+		pMem->loadVariable = Symbols::None;
 
 		all_parser_mems[name] = std::move(pMem);
 	}
 
-	static AST::Type* FindType(std::string name) {
+	// Type of a com, mem or argument, nullptr for any other name.
+	static AST::Type* LookupType(Symbol name) {
+
+		auto com = all_parser_coms.find(name);
+		auto mem = all_parser_mems.find(name);
 
-		if(all_parser_coms.find(name) != all_parser_coms.end()) {
-			return all_parser_coms[name];
+		if(com != all_parser_coms.end()) {
+			return com->second;
 		}
-		else if(all_parser_mems.find(name) != all_parser_mems.end()) {
-			return all_parser_mems[name]->ty;
+		else if(mem != all_parser_mems.end()) {
+			return mem->second->ty;
 		}
 		else {
 
-			for(auto const& i : all_procedures) {
-
-				if(i->procName == Parser::current_procedure_name) {
+			auto arg = current_argument_types.find(name);
 
-					//std::cout << "Checking Procedure " << i->procName << " with Current " << Parser::current_procedure_name << "...\n";
-
-					//if(i->all_arguments.size() == 0) {
-					//	std::cout << i->procName << " has no arguments!\n";
-					//}
+			if(arg != current_argument_types.end()) {
+				return arg->second;
+			}
+		}
 
-					int Idx = 0;
-					for(auto const& args : i->all_arguments) {
+		return nullptr;
+	}
 
-						//std::cout << "Checking " << args->name << "...\n";
-						if(args->name == name) {
+	static AST::Type* FindType(Symbol name) {
 
-							return i->all_argument_types[Idx].get();
-						}
+		AST::Type* ty = LookupType(name);
 
-						Idx++;
-					}
-				}
-			}
+		if(ty == nullptr) {
+			ExprError("Variable type of '" + std::string(Symbols::Name(name)) + "' not found.");
 		}
 
-		ExprError("Variable type of '" + name + "' not found.");
-		return nullptr;
+		return ty;
 	}
 
-	static std::unique_ptr<AST::Type> CopyType(AST::Type* t) {
+	static AST::Owned<AST::Type> CopyType(AST::Type* t) {
 
-		if(dynamic_cast<AST::Integer128*>(t)) { return std::make_unique<AST::Integer128>(); }
-		else if(dynamic_cast<AST::Integer64*>(t)) { return std::make_unique<AST::Integer64>(); }
-		else if(dynamic_cast<AST::Integer32*>(t)) { return std::make_unique<AST::Integer32>(); }
-		else if(dynamic_cast<AST::Integer16*>(t)) { return std::make_unique<AST::Integer16>(); }
-		else if(dynamic_cast<AST::Integer8*>(t)) { return std::make_unique<AST::Integer8>(); }
-		else if(dynamic_cast<AST::Integer1*>(t)) { return std::make_unique<AST::Integer1>(); }
+		if(llvm::isa<AST::Integer128, AST::Integer64, AST::Integer32, AST::Integer16, AST::Integer8, AST::Integer1>(t)) {
+			return t->Clone();
+		}
 
 		ExprError("Variable type to Copy not found.");
 		return nullptr;
@@ -102,11 +196,11 @@ struct Parser {
 
 	static void StartMainTargetSystem() {
 
-		Parser::main_target.clear();
+		Parser::main_target = Symbols::None;
 		Parser::can_main_target_be_modified = true;
 	}
 
-	static void SetMainTarget(std::string n) {
+	static void SetMainTarget(Symbol n) {
 
 		if(can_main_target_be_modified) {
 			Parser::main_target = n;
@@ -116,60 +210,87 @@ struct Parser {
 
 	static void ResetMainTarget() {
 
-		Parser::main_target.clear();
+		Parser::main_target = Symbols::None;
 		Parser::can_main_target_be_modified = true;
 	}
 
 	static void ExprError(std::string str) {
-		std::cout << "Parser Error: " << str << "\n";
-		exit(1);
-	}
 
-	static std::unique_ptr<AST::Procedure> CloneProcedure(std::string name) {
+		bool first = false;
+
+		// Only the first thread to fail gets to print. The location is found
+		// under the lock too, since the first lookup builds the lexer's line
+		// index that every worker shares. The lock is let go before the
+		// process ends so no worker is left blocked on it.
+		{
+			std::lock_guard<std::mutex> guard(error_lock);
+
+			if(!error_reported) {
+
+				int line = 0;
+				int column = 0;
 
-		for(auto const& i: all_procedures) {
+				source->GetLocation(source->Tokens.Offsets[token_index], line, column);
 
-			if(i->procName == name) {
-				return i->Clone();
+				std::cout << "Parser Error: " << str << " (line " << line << ", column " << column << ")\n";
+				std::cout << "\t" << source->GetLineText(line) << "\n";
+
+				std::cout.flush();
+				error_reported = true;
+				first = true;
 			}
 		}
 
-		ExprError("Procedure '" + name + "' not found.");
-		return nullptr;
+		// A later failure only waits for the first one to end the process.
+		while(!first) {
+			std::this_thread::sleep_for(std::chrono::seconds(1));
+		}
+
+		// Other workers may still be parsing, so the statics they use must
+		// not be destroyed under them as exit() would.
+		std::_Exit(1);
 	}
 
-	static void AddCallCountToProcedure(std::string name) {
+	static AST::Procedure* FindProcedure(Symbol name) {
 
-		for(auto const& i: all_procedures) {
+		auto found = procedure_index.find(name);
 
-			if(i->procName == name) {
-				i->call_count += 1;
-				return;
-			}
+		if(found == procedure_index.end()) {
+			ExprError("Procedure '" + std::string(Symbols::Name(name)) + "' not found.");
 		}
 
-		ExprError("Procedure '" + name + "' not found.");
+		return found->second.proc;
 	}
 
-	static std::unique_ptr<AST::Expression> ParseCall(std::string name) {
+	static void RequestBody(Symbol name) {
 
-		Lexer::GetNextToken();
+		std::lock_guard<std::mutex> guard(requested_lock);
 
-		std::vector<std::unique_ptr<AST::Expression>> call_arguments;
+		requested_bodies.push_back(name);
+	}
+
+	static AST::Owned<AST::Expression> ParseCall(Symbol name) {
+
+		NextToken();
 
-		AddCallCountToProcedure(name);
+		AST::Vector<AST::Owned<AST::Expression>> call_arguments;
 
-		std::unique_ptr<AST::Procedure> proc_copy = CloneProcedure(name);
-		CLONE_EXPR_VECTOR(proc_copy->body, body_clone);
+		AST::Procedure* proc = FindProcedure(name);
+
+		// Only the first call asks for the body, a procedure nothing calls
+		// is never parsed.
+		if(proc->call_count.fetch_add(1) == 0) {
+			RequestBody(name);
+		}
 
-		while(Lexer::CurrentToken != ')') {
+		while(CurrentToken() != ')') {
 
 			auto I = ParseIdentifier();
 
-			call_arguments.push_back(std::move(I));
+			call_arguments.push_back(MemTreatment(std::move(I)));
 
-			if(Lexer::CurrentToken != ',') {
-				if(Lexer::CurrentToken != ')') {
+			if(CurrentToken() != ',') {
+				if(CurrentToken() != ')') {
 					ExprError("Expected ',' to split arguments or ')' to end call.");
 				}
 				else {
@@ -177,216 +298,327 @@ struct Parser {
 				}
 			}
 
-			Lexer::GetNextToken();
+			NextToken();
 		}
 
-		if(Lexer::CurrentToken == ')') {
-			Lexer::GetNextToken();
+		if(call_arguments.size() != proc->all_arguments.size()) {
+			ExprError("Procedure '" + std::string(Symbols::Name(name)) + "' takes " + std::to_string(proc->all_arguments.size()) + " arguments.");
 		}
 
-		bool isVoid = dynamic_cast<AST::Void*>(proc_copy->proc_type.get()) != nullptr;
+		if(CurrentToken() == ')') {
+			NextToken();
+		}
 
-		if(!isVoid) {
+		return AST::New<AST::Call>(name, std::move(call_arguments), proc->proc_type->Clone());
+	}
 
-			for(auto const& i: body_clone) {
+	static AST::Owned<AST::Expression> ParseIdentifier() {
 
-				if(i->ContainsName(name + "_return")) {
-					i->ReplaceTargetNameTo(name + "_return", name + "_return" + std::to_string(proc_copy->call_count));
-				}
-			}
+		Symbol idName = TokenSymbol();
+
+		NextToken();
+
+		if(CurrentToken() == '(') {
+			return ParseCall(idName);
 		}
 
-		for(auto const& i: body_clone) {
+		SetMainTarget(idName);
 
-			int Idx = 0;
-			for(auto const& p: proc_copy->all_arguments) {
+		return AST::New<AST::Variable>(idName);
+	}
 
-				if(i->ContainsName(p->name)) {
+	static unsigned DigitValue(char c) {
 
-					i->ReplaceTargetNameTo(p->name, call_arguments[Idx]->name);
-				}
+		if(c >= '0' && c <= '9') return c - '0';
+
+		c |= 0x20;
+
+		if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+
+		return 16;
+	}
+
+	// Reads a literal straight from its source text, to be fitted to 'ty'.
+	// Accepts decimal, '0x' hex and '0b' binary, with '_' as a separator.
+	// Most literals are read into a uint64_t and come back as a 64-bit APInt,
+	// which keeps its value inline. Only one of 2^63 and up is made at the
+	// width of 'ty', see ParseWideLiteral.
+	static llvm::APInt ParseIntLiteral(std::string_view text, AST::Type* ty) {
 
-				Idx++;
+		if(text[0] == '\'') {
+			return llvm::APInt(64, Lexer::CharLiteralValue(text), true);
+		}
+
+		unsigned radix = 10;
+		size_t i = 0;
+
+		if(text.size() > 1 && text[0] == '0' && (text[1] | 0x20) == 'x') { radix = 16; i = 2; }
+		else if(text.size() > 1 && text[0] == '0' && (text[1] | 0x20) == 'b') { radix = 2; i = 2; }
+
+		size_t first = i;
+		uint64_t value = 0;
+		size_t digits = 0;
+
+		for(; i < text.size(); i++) {
+
+			if(text[i] == '_') continue;
+
+			unsigned digit = DigitValue(text[i]);
+
+			if(digit >= radix) {
+				ExprError("Invalid number '" + std::string(text) + "'.");
 			}
+
+			if(value > (UINT64_MAX - digit) / radix) {
+				return ParseWideLiteral(text, first, radix, ty);
+			}
+
+			value = value * radix + digit;
+			digits++;
 		}
 
-		std::unique_ptr<AST::Expression> returnObj;
+		if(digits == 0) {
+			ExprError("Invalid number '" + std::string(text) + "'.");
+		}
+
+		unsigned bits = ty->BitWidth();
 
-		if(!isVoid) {
-			returnObj = std::make_unique<AST::Variable>(name + "_return" + std::to_string(proc_copy->call_count));
+		if(bits < 64 && (value >> bits) != 0) {
+			ExprError("Number '" + std::string(text) + "' does not fit in " + ty->ToLLMascal().str() + ".");
 		}
-		else {
-			returnObj = std::make_unique<AST::RetVoid>();
+
+		// A sign bit clear at 64 bits means sign extending it later is exact.
+		if((value >> 63) == 0) {
+			return llvm::APInt(64, value);
 		}
 
-		return std::make_unique<AST::ProcedureCall>(std::move(body_clone), std::move(returnObj));
+		return llvm::APInt(std::max(bits, 64u), value);
 	}
 
-	static std::unique_ptr<AST::Expression> ParseIdentifier() {
+	// A literal that doesn't fit in 64 bits, read again digit by digit
+	// from 'first' at the width of 'ty'.
+	static llvm::APInt ParseWideLiteral(std::string_view text, size_t first, unsigned radix, AST::Type* ty) {
 
-		std::string idName = Lexer::IdentifierStr;
+		unsigned bits = ty->BitWidth();
 
-		Lexer::GetNextToken();
+		// A few spare bits so 'value * radix + digit' can't wrap before it's checked.
+		llvm::APInt value(bits + 5, 0);
 
-		if(Lexer::CurrentToken == '(') {
-			return ParseCall(idName);
+		for(size_t i = first; i < text.size(); i++) {
+
+			if(text[i] == '_') continue;
+
+			unsigned digit = DigitValue(text[i]);
+
+			if(digit >= radix) {
+				ExprError("Invalid number '" + std::string(text) + "'.");
+			}
+
+			value *= radix;
+			value += digit;
+
+			if(value.getActiveBits() > bits) {
+				ExprError("Number '" + std::string(text) + "' does not fit in " + ty->ToLLMascal().str() + ".");
+			}
 		}
 
-		SetMainTarget(idName);
+		return value.trunc(bits);
+	}
+
+	// A literal is checked against the widest type. Its own type is only
+	// known once it's clear what it meets, see FitLiteral.
+	static AST::Owned<AST::Expression> ParseNumber() {
+
+		AST::Owned<AST::Type> ty = AST::New<AST::Integer128>();
 
-		return std::make_unique<AST::Variable>(idName);
+		llvm::APInt n = ParseIntLiteral(TokenText(), ty.get());
+
+		NextToken();
+
+		return AST::New<AST::IntNumber>(std::move(n), std::move(ty));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseNumber() {
+	// The type a literal gets when no operand decides it: the one of the
+	// statement's target, or i32 when there's none.
+	static AST::Owned<AST::Type> TargetType() {
 
-		int64_t n = std::stoi(Lexer::NumValString);
+		if(Parser::main_target == Symbols::None) {
+			return AST::New<AST::Integer32>();
+		}
+
+		return CopyType(FindType(Parser::main_target));
+	}
 
-		Lexer::GetNextToken();
+	// Narrows a literal, or a folded run of them, to 'ty'. It has to fit as
+	// an unsigned or a signed number. A folded comparison stays an i1.
+	static void FitLiteral(AST::IntNumber* n, AST::Type* ty) {
 
-		if(Parser::main_target == "") {
-			return std::make_unique<AST::IntNumber>(n, std::make_unique<AST::Integer32>());
+		if(llvm::isa<AST::Integer1>(n->ty.get())) {
+			return;
 		}
 
-		return std::make_unique<AST::IntNumber>(n, CopyType(FindType(Parser::main_target)));
+		unsigned bits = ty->BitWidth();
+
+		if(!n->num.isIntN(bits) && !n->num.isSignedIntN(bits)) {
+			ExprError("Number '" + llvm::toString(n->num, 10, n->num.isSignBitSet()) + "' does not fit in " + ty->ToLLMascal().str() + ".");
+		}
+
+		n->num = n->num.sextOrTrunc(bits);
+		n->ty = CopyType(ty);
 	}
 
-	static std::unique_ptr<AST::Type> IdentStrToType() {
+	static AST::Owned<AST::Type> IdentStrToType() {
 
-		std::string curr_ident = Lexer::IdentifierStr;
+		std::string_view curr_ident = TokenText();
 
-		if(curr_ident == "i128") { return std::make_unique<AST::Integer128>(); }
-		else if(curr_ident == "i64") { return std::make_unique<AST::Integer64>(); }
-		else if(curr_ident == "i32") { return std::make_unique<AST::Integer32>(); }
-		else if(curr_ident == "i16") { return std::make_unique<AST::Integer16>(); }
-		else if(curr_ident == "i8") { return std::make_unique<AST::Integer8>(); }
-		else if(curr_ident == "i1" || curr_ident == "bool") { return std::make_unique<AST::Integer1>(); }
+		if(curr_ident == "i128") { return AST::New<AST::Integer128>(); }
+		else if(curr_ident == "i64") { return AST::New<AST::Integer64>(); }
+		else if(curr_ident == "i32") { return AST::New<AST::Integer32>(); }
+		else if(curr_ident == "i16") { return AST::New<AST::Integer16>(); }
+		else if(curr_ident == "i8") { return AST::New<AST::Integer8>(); }
+		else if(curr_ident == "i1" || curr_ident == "bool") { return AST::New<AST::Integer1>(); }
 
-		else if(curr_ident == "void") { return std::make_unique<AST::Void>(); }
+		else if(curr_ident == "void") { return AST::New<AST::Void>(); }
 
 		ExprError("Unknown type found.");
 		return nullptr;
 	}
 
-	static std::unique_ptr<AST::Expression> ParseCom() {
+	static AST::Owned<AST::Expression> ParseCom() {
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		std::string idName = Lexer::IdentifierStr;
+		Symbol idName = TokenSymbol();
 
 		SetMainTarget(idName);
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		if(Lexer::CurrentToken != ':') { ExprError("Expected ':'."); }
+		if(CurrentToken() != ':') { ExprError("Expected ':'."); }
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		std::unique_ptr<AST::Type> ty = IdentStrToType();
+		AST::Owned<AST::Type> ty = IdentStrToType();
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		if(Lexer::CurrentToken != '=') { ExprError("Expected '='."); }
+		if(CurrentToken() != '=') { ExprError("Expected '='."); }
 
-		Lexer::GetNextToken();
+		NextToken();
 
 		AddParserCom(idName, ty.get());
 
-		std::unique_ptr<AST::Expression> expr = ParseExpression();
+		AST::Owned<AST::Expression> expr = ParseExpression();
 
-		auto final_com = std::make_unique<AST::Com>(idName, std::move(ty), std::move(expr));
+		CheckStoredType(idName, expr.get());
+
+		auto final_com = AST::New<AST::Com>(idName, std::move(ty), MemTreatment(std::move(expr)));
 
 		return final_com;
 	}
 
-	static std::unique_ptr<AST::Expression> ParseMem() {
+	static AST::Owned<AST::Expression> ParseMem() {
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		std::string idName = Lexer::IdentifierStr;
+		Symbol idName = TokenSymbol();
 
 		SetMainTarget(idName);
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		if(Lexer::CurrentToken != ':') { ExprError("Expected ':'."); }
+		if(CurrentToken() != ':') { ExprError("Expected ':'."); }
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		std::unique_ptr<AST::Type> ty = IdentStrToType();
+		AST::Owned<AST::Type> ty = IdentStrToType();
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		if(Lexer::CurrentToken != '=') { ExprError("Expected '='."); }
+		if(CurrentToken() != '=') { ExprError("Expected '='."); }
 
-		Lexer::GetNextToken();
+		NextToken();
 
 		AddParserMem(idName, ty.get());
 
-		std::unique_ptr<AST::Expression> expr = ParseExpression();
+		AST::Owned<AST::Expression> expr = ParseExpression();
+
+		CheckStoredType(idName, expr.get());
 
-		auto final_mem = std::make_unique<AST::Mem>(idName, std::move(ty), std::move(expr));
+		auto final_mem = AST::New<AST::Mem>(idName, std::move(ty), MemTreatment(std::move(expr)));
 
 		return final_mem;
 	}
 
-	static std::unique_ptr<AST::Expression> ParseLLReturn() {
+	static AST::Owned<AST::Expression> ParseLLReturn() {
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		std::unique_ptr<AST::Expression> expr = ParseExpression();
+		AST::Owned<AST::Expression> expr = ParseExpression();
 
-		return std::make_unique<AST::LLReturn>(MemTreatment(std::move(expr)));
+		// The program is main, which returns an i32.
+		AST::Type* ty = OperandType(expr.get());
+
+		if(Parser::isInside == LexerIsInside::AProgram && ty != nullptr && ty->BitWidth() != 32) {
+			ExprError("The program returns an i32, found " + ty->ToLLMascal().str() + ". Use a cast.");
+		}
+
+		return AST::New<AST::LLReturn>(MemTreatment(std::move(expr)));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseReturn() {
+	static AST::Owned<AST::Expression> ParseReturn() {
 
-		if(Lexer::isInside == LexerIsInside::AProgram) {
+		if(Parser::isInside == LexerIsInside::AProgram) {
 			return ParseLLReturn();
 		}
 
-		Lexer::GetNextToken();
+		NextToken();
 
 		ResetMainTarget();
 
-		SetMainTarget(Parser::current_procedure_name + "_return");
+		Symbol returnName = Suffixed(Parser::current_procedure_name, "_return");
+
+		SetMainTarget(returnName);
+
+		AST::Owned<AST::Expression> expr = ParseExpression();
 
-		std::unique_ptr<AST::Expression> expr = ParseExpression();
+		CheckStoredType(returnName, expr.get());
 
-		return std::make_unique<AST::ComStore>(std::make_unique<AST::Variable>(Parser::current_procedure_name + "_return"), std::move(expr));
+		return AST::New<AST::ComStore>(AST::New<AST::Variable>(returnName), MemTreatment(std::move(expr)));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseAdd() {
+	static AST::Owned<AST::Expression> ParseAdd() {
 
-		Lexer::GetNextToken();
+		NextToken();
 
 		ResetMainTarget();
 
-		std::unique_ptr<AST::Expression> target = ParseExpression();
+		AST::Owned<AST::Expression> target = ParseExpression();
 
-		if(Lexer::CurrentToken != ',') { ExprError("Expected ','."); }
+		if(CurrentToken() != ',') { ExprError("Expected ','."); }
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		std::unique_ptr<AST::Expression> value = ParseExpression();
+		AST::Owned<AST::Expression> value = ParseExpression();
 
-		return std::make_unique<AST::Add>(std::move(target), MemTreatment(std::move(value)));
+		return AST::New<AST::Add>(std::move(target), MemTreatment(std::move(value)));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseSub() {
+	static AST::Owned<AST::Expression> ParseSub() {
 
-		Lexer::GetNextToken();
+		NextToken();
 
 		ResetMainTarget();
 
-		std::unique_ptr<AST::Expression> target = ParseExpression();
+		AST::Owned<AST::Expression> target = ParseExpression();
 
-		if(Lexer::CurrentToken != ',') { ExprError("Expected ','."); }
+		if(CurrentToken() != ',') { ExprError("Expected ','."); }
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		std::unique_ptr<AST::Expression> value = ParseExpression();
+		AST::Owned<AST::Expression> value = ParseExpression();
 
-		return std::make_unique<AST::Sub>(std::move(target), MemTreatment(std::move(value)));
+		return AST::New<AST::Sub>(std::move(target), MemTreatment(std::move(value)));
 	}
 
 	static int TextToCompareType(std::string t) {
@@ -411,299 +643,347 @@ struct Parser {
 		return 0;
 	}
 
-	static std::unique_ptr<AST::Expression> ParseCompare() {
+	static AST::Owned<AST::Expression> ParseCompare() {
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		if(Lexer::CurrentToken != '.') {
+		if(CurrentToken() != '.') {
 			ExprError("Expected '.'");
 		}
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		std::string compareType = Lexer::IdentifierStr;
+		std::string compareType(TokenText());
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		if(Lexer::CurrentToken != '(') {
+		if(CurrentToken() != '(') {
 			ExprError("Expected '(' to add arguments.");
 		}
 
-		Lexer::GetNextToken();
+		NextToken();
 
 		auto CompareOne = ParseExpression();
 
-		if(Lexer::CurrentToken != ',') {
+		if(CurrentToken() != ',') {
 			ExprError("Expected ',' to split arguments.");
 		}
 
-		Lexer::GetNextToken();
+		NextToken();
 
 		auto CompareTwo = ParseExpression();
 
-		if(Lexer::CurrentToken != ')') {
+		if(CurrentToken() != ')') {
 			ExprError("Expected ')' to close arguments.");
 		}
 
-		Lexer::GetNextToken();
+		NextToken();
 
 		int finalCompare = TextToCompareType(compareType);
 
-		return std::make_unique<AST::Compare>(MemTreatment(std::move(CompareOne)), MemTreatment(std::move(CompareTwo)), finalCompare);
+		return AST::New<AST::Compare>(MemTreatment(std::move(CompareOne)), MemTreatment(std::move(CompareTwo)), finalCompare);
 	}
 
-	static std::unique_ptr<AST::Expression> ParseIf(bool check_comma = true) {
+	// Stores every mem whose value is only in a com back, and forgets the coms
+	// mems were loaded into. Both ways of an 'if' and every pass through a
+	// loop start and end like this: a com loaded on one path doesn't exist on
+	// the other, and a loop body has to leave the mems as its next run reads them.
+	static void StoreBackMems(AST::Vector<AST::Owned<AST::Expression>>& out) {
 
-		Lexer::GetNextToken();
+		for(auto const& i : all_parser_mems) {
+
+			Parser_Mem* pMem = i.second.get();
+
+			if(pMem->loadVariable != Symbols::None && !pMem->is_verified) {
+				out.push_back(AST::New<AST::MemStore>(AST::New<AST::Variable>(i.first), AST::New<AST::Variable>(pMem->loadVariable)));
+			}
+
+			pMem->loadVariable = Symbols::None;
+			pMem->is_verified = true;
+		}
+	}
+
+	static AST::Owned<AST::Expression> ParseIf(bool check_comma = true) {
+
+		NextToken();
+
+		AST::Vector<AST::Owned<AST::Expression>> mem_stores;
+
+		StoreBackMems(mem_stores);
 
 		auto condition = ParseExpression();
 
-		if(Lexer::CurrentToken != Token::Then) {
+		// The condition's target must not type the literals of the body.
+		ResetMainTarget();
+
+		if(CurrentToken() != Token::Then) {
 			ExprError("Expected 'then' in if block.");
 		}
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		std::vector<std::unique_ptr<AST::Expression>> if_body;
-		std::vector<std::unique_ptr<AST::Expression>> else_body;
+		AST::Vector<AST::Owned<AST::Expression>> if_body;
+		AST::Vector<AST::Owned<AST::Expression>> else_body;
 
-		while(Lexer::CurrentToken != Token::End && Lexer::CurrentToken != Token::Else) {
+		while(CurrentToken() != Token::End && CurrentToken() != Token::Else) {
 
-			std::unique_ptr<AST::Expression> e = ParseExpression();
+			AST::Owned<AST::Expression> e = ParseExpression();
 
-			if(Lexer::CurrentToken != ';') { ExprError("Expected ';' to end instruction inside if block."); }
+			if(CurrentToken() != ';') { ExprError("Expected ';' to end instruction inside if block."); }
 
 			if_body.push_back(std::move(e));
 
 			ResetMainTarget();
 
-			Lexer::GetNextToken();
+			NextToken();
 		}
 
-		if(Lexer::CurrentToken == Token::Else) {
+		StoreBackMems(if_body);
+
+		if(CurrentToken() == Token::Else) {
 
-			Lexer::GetNextToken();
+			NextToken();
 
-			if(Lexer::CurrentToken == Token::If) {
-				std::unique_ptr<AST::Expression> if_b = ParseIf(false);
+			if(CurrentToken() == Token::If) {
+				AST::Owned<AST::Expression> if_b = ParseIf(false);
 
 				else_body.push_back(std::move(if_b));
 			}
-			else if(Lexer::CurrentToken == Token::Then) {
+			else if(CurrentToken() == Token::Then) {
 
-				Lexer::GetNextToken();
+				NextToken();
 
-				while(Lexer::CurrentToken != Token::End) {
+				while(CurrentToken() != Token::End) {
 
-					std::unique_ptr<AST::Expression> e = ParseExpression();
+					AST::Owned<AST::Expression> e = ParseExpression();
 
-					if(Lexer::CurrentToken != ';') { ExprError("Expected ';' to end instruction inside else block."); }
+					if(CurrentToken() != ';') { ExprError("Expected ';' to end instruction inside else block."); }
 		
 					else_body.push_back(std::move(e));
 		
 					ResetMainTarget();
 		
-					Lexer::GetNextToken();
+					NextToken();
 				}
 			}
 			else {
 				ExprError("Expected 'if' or 'then' in else block.");
 			}
+
+			StoreBackMems(else_body);
 		}
 
 		if(check_comma)
-			Lexer::GetNextToken();
+			NextToken();
 
-		return std::make_unique<AST::If>(std::move(condition), std::move(if_body), std::move(else_body));
+		return AST::New<AST::If>(std::move(condition), std::move(if_body), std::move(else_body), std::move(mem_stores));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseComStore() {
+	static AST::Owned<AST::Expression> ParseComStore() {
 
-		Lexer::GetNextToken();
+		NextToken();
 
 		ResetMainTarget();
 
-		std::unique_ptr<AST::Expression> target = ParseExpression();
+		AST::Owned<AST::Expression> target = ParseExpression();
 
-		if(Lexer::CurrentToken != ',') { ExprError("Expected ','."); }
+		if(CurrentToken() != ',') { ExprError("Expected ','."); }
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		std::unique_ptr<AST::Expression> value = ParseExpression();
+		AST::Owned<AST::Expression> value = ParseExpression();
 
-		return std::make_unique<AST::ComStore>(std::move(target), MemTreatment(std::move(value)));
+		return AST::New<AST::ComStore>(std::move(target), MemTreatment(std::move(value)));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseMemStore() {
+	static AST::Owned<AST::Expression> ParseMemStore() {
 
-		Lexer::GetNextToken();
+		NextToken();
 
 		ResetMainTarget();
 
-		std::unique_ptr<AST::Expression> target = ParseExpression();
+		AST::Owned<AST::Expression> target = ParseExpression();
 
-		if(Lexer::CurrentToken != ',') { ExprError("Expected ','."); }
+		if(CurrentToken() != ',') { ExprError("Expected ','."); }
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		std::unique_ptr<AST::Expression> value = ParseExpression();
+		AST::Owned<AST::Expression> value = ParseExpression();
 
-		return std::make_unique<AST::MemStore>(std::move(target), MemTreatment(std::move(value)));
+		return AST::New<AST::MemStore>(std::move(target), MemTreatment(std::move(value)));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseLoadMem() {
+	static AST::Owned<AST::Expression> ParseLoadMem() {
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		std::unique_ptr<AST::Expression> expr = ParseExpression();
+		AST::Owned<AST::Expression> expr = ParseExpression();
 
-		return std::make_unique<AST::LoadMem>(std::move(expr));
+		return AST::New<AST::LoadMem>(std::move(expr));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseIntCast() {
+	static AST::Owned<AST::Expression> ParseIntCast() {
 
-		Lexer::GetNextToken();
+		NextToken();
 
 		ResetMainTarget();
 
 		auto Expr = ParseExpression();
 
-		if(Lexer::CurrentToken != Token::To) {
+		if(CurrentToken() != Token::To) {
 			ExprError("Expected 'to'.");
 		}
 
-		Lexer::GetNextToken();
+		NextToken();
 
 		auto ty = IdentStrToType();
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		return std::make_unique<AST::IntCast>(MemTreatment(std::move(Expr)), std::move(ty));
+		return AST::New<AST::IntCast>(MemTreatment(std::move(Expr)), std::move(ty));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseWhile() {
+	static AST::Owned<AST::Expression> ParseWhile() {
+
+		NextToken();
+
+		AST::Vector<AST::Owned<AST::Expression>> mem_stores;
 
-		Lexer::GetNextToken();
+		StoreBackMems(mem_stores);
 
 		auto Cond = ParseExpression();
 
-		if(Lexer::CurrentToken != Token::Do) {
+		ResetMainTarget();
+
+		if(CurrentToken() != Token::Do) {
 			ExprError("Expected 'do' keyword.");
 		}
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		std::vector<std::unique_ptr<AST::Expression>> loop_body;
+		AST::Vector<AST::Owned<AST::Expression>> loop_body;
 
-		while(Lexer::CurrentToken != Token::End) {
+		while(CurrentToken() != Token::End) {
 
-			std::unique_ptr<AST::Expression> e = ParseExpression();
+			AST::Owned<AST::Expression> e = ParseExpression();
 
-			if(Lexer::CurrentToken != ';') { ExprError("Expected ';' to end instruction inside while loop."); }
+			if(CurrentToken() != ';') { ExprError("Expected ';' to end instruction inside while loop."); }
 
 			loop_body.push_back(std::move(e));
 
 			ResetMainTarget();
 
-			Lexer::GetNextToken();
+			NextToken();
 		}
 
-		Lexer::GetNextToken();
+		StoreBackMems(loop_body);
+
+		NextToken();
 
-		return std::make_unique<AST::While>(std::move(Cond), std::move(loop_body));
+		return AST::New<AST::While>(std::move(Cond), std::move(loop_body), std::move(mem_stores));
 	}
 
-	static std::unique_ptr<AST::Expression> ParsePrimary() {
+	static AST::Owned<AST::Expression> ParsePrimary() {
 
-		if(Lexer::CurrentToken == Token::Identifier) 	{ return ParseIdentifier(); }
-		else if(Lexer::CurrentToken == Token::Number) 	{ return ParseNumber(); }
-		else if(Lexer::CurrentToken == Token::Com) 		{ return ParseCom(); }
-		else if(Lexer::CurrentToken == Token::LLReturn) { return ParseLLReturn(); }
+		if(CurrentToken() == Token::Identifier) 	{ return ParseIdentifier(); }
+		else if(CurrentToken() == Token::Number) 	{ return ParseNumber(); }
+		else if(CurrentToken() == Token::Com) 		{ return ParseCom(); }
+		else if(CurrentToken() == Token::LLReturn) { return ParseLLReturn(); }
 
-		else if(Lexer::CurrentToken == Token::Add) 		{ return ParseAdd(); }
-		else if(Lexer::CurrentToken == Token::Sub) 		{ return ParseSub(); }
+		else if(CurrentToken() == Token::Add) 		{ return ParseAdd(); }
+		else if(CurrentToken() == Token::Sub) 		{ return ParseSub(); }
 
-		else if(Lexer::CurrentToken == Token::Compare) 	{ return ParseCompare(); }
+		else if(CurrentToken() == Token::Compare) 	{ return ParseCompare(); }
 
-		else if(Lexer::CurrentToken == Token::If) { return ParseIf(); }
+		else if(CurrentToken() == Token::If) { return ParseIf(); }
 
-		else if(Lexer::CurrentToken == Token::Return) { return ParseReturn(); }
+		else if(CurrentToken() == Token::Return) { return ParseReturn(); }
 
-		else if(Lexer::CurrentToken == Token::ComStore) { return ParseComStore(); }
+		else if(CurrentToken() == Token::ComStore) { return ParseComStore(); }
 
-		else if(Lexer::CurrentToken == Token::Mem) { return ParseMem(); }
-		else if(Lexer::CurrentToken == Token::LoadMem) { return ParseLoadMem(); }
-		else if(Lexer::CurrentToken == Token::MemStore) { return ParseMemStore(); }
+		else if(CurrentToken() == Token::Mem) { return ParseMem(); }
+		else if(CurrentToken() == Token::LoadMem) { return ParseLoadMem(); }
+		else if(CurrentToken() == Token::MemStore) { return ParseMemStore(); }
 
-		else if(Lexer::CurrentToken == Token::IntCast) { return ParseIntCast(); }
+		else if(CurrentToken() == Token::IntCast) { return ParseIntCast(); }
 
-		else if(Lexer::CurrentToken == Token::While) { return ParseWhile(); }
+		else if(CurrentToken() == Token::While) { return ParseWhile(); }
+
+		else if(CurrentToken() == '(') { return ParseParenthesized(); }
 
 		ExprError("Unknown expression found.");
 		return nullptr;
 	}
 
-	static std::unique_ptr<AST::Expression> Mem_CreateAutoLoad(std::unique_ptr<AST::Expression> V, std::vector<std::unique_ptr<AST::Expression>> ext_init = {} ) {
+	static AST::Owned<AST::Expression> Mem_CreateAutoLoad(AST::Owned<AST::Expression> V, AST::Vector<AST::Owned<AST::Expression>> ext_init = {} ) {
+
+		Parser_Mem* pMem = Parser::all_parser_mems[V->name].get();
 
-		Parser::all_parser_mems[V->name]->loadCount += 1;
-		Parser::all_parser_mems[V->name]->loadVariableName = V->name + "_load" + std::to_string(Parser::all_parser_mems[V->name]->loadCount);
+		pMem->loadCount += 1;
+		pMem->loadVariable = Suffixed(V->name, "_load" + std::to_string(pMem->loadCount));
 
-		auto newCom = std::make_unique<AST::Com>(
-			Parser::all_parser_mems[V->name]->loadVariableName, 
-			CopyType(Parser::all_parser_mems[V->name]->ty),
-			std::make_unique<AST::LoadMem>(std::move(V))
+		auto newCom = AST::New<AST::Com>(
+			pMem->loadVariable, 
+			CopyType(pMem->ty),
+			AST::New<AST::LoadMem>(std::move(V))
 		);
 
-		std::string getComName = newCom->name;
+		Symbol getComName = newCom->name;
 
-		std::vector<std::unique_ptr<AST::Expression>> addVec;
+		AST::Vector<AST::Owned<AST::Expression>> addVec;
 
 		addVec = std::move(ext_init);
 
 		addVec.push_back(std::move(newCom));
 
-		return std::make_unique<AST::Variable>(getComName, std::move(addVec));
+		return AST::New<AST::Variable>(getComName, std::move(addVec));
 	}
 
-	static std::unique_ptr<AST::Expression> Mem_CreateAutoStoreAndVerify(std::unique_ptr<AST::Expression> V) {
+	static AST::Owned<AST::Expression> Mem_CreateAutoStoreAndVerify(AST::Owned<AST::Expression> V) {
 
-		std::string getVName = V->name;
-		std::string getLoadName = Parser::all_parser_mems[V->name]->loadVariableName;
+		Symbol getVName = V->name;
+		Parser_Mem* pMem = Parser::all_parser_mems[V->name].get();
 
-		Parser::all_parser_mems[V->name]->loadVariableName.clear();
+		Symbol getLoadName = pMem->loadVariable;
 
-		Parser::all_parser_mems[V->name]->is_verified = true;
+		pMem->loadVariable = Symbols::None;
 
-		std::vector<std::unique_ptr<AST::Expression>> initStore;
+		pMem->is_verified = true;
+
+		AST::Vector<AST::Owned<AST::Expression>> initStore;
 
-		initStore.push_back(std::make_unique<AST::MemStore>(std::move(V), std::make_unique<AST::Variable>(getLoadName)));
+		initStore.push_back(AST::New<AST::MemStore>(std::move(V), AST::New<AST::Variable>(getLoadName)));
 
-		return Mem_CreateAutoLoad(std::make_unique<AST::Variable>(getVName), std::move(initStore));
+		return Mem_CreateAutoLoad(AST::New<AST::Variable>(getVName), std::move(initStore));
 	}
 
-	static std::unique_ptr<AST::Expression> MemTreatment(std::unique_ptr<AST::Expression> V, bool is_left_ident = false) {
+	static AST::Owned<AST::Expression> MemTreatment(AST::Owned<AST::Expression> V, bool is_left_ident = false) {
+
+		auto found = Parser::all_parser_mems.find(V->name);
 
-		if(Parser::all_parser_mems.find(V->name) == Parser::all_parser_mems.end())
+		if(found == Parser::all_parser_mems.end())
 			return V;
 
-		if(Parser::all_parser_mems[V->name]->loadVariableName == "" && Parser::all_parser_mems[V->name]->is_verified) {
+		Parser_Mem* pMem = found->second.get();
+
+		if(pMem->loadVariable == Symbols::None && pMem->is_verified) {
 			return Mem_CreateAutoLoad(std::move(V));
 		}
 		else if(!is_left_ident) {
 
-			if(Parser::all_parser_mems[V->name]->loadVariableName != "" && !Parser::all_parser_mems[V->name]->is_verified) {
+			if(pMem->loadVariable != Symbols::None && !pMem->is_verified) {
 				return Mem_CreateAutoStoreAndVerify(std::move(V));
 			}
 		}
 
-		return std::make_unique<AST::Variable>(Parser::all_parser_mems[V->name]->loadVariableName);
+		return AST::New<AST::Variable>(pMem->loadVariable);
 	}
 
-	static std::unique_ptr<AST::Expression> UnverifyMem(std::unique_ptr<AST::Expression> V) {
+	static AST::Owned<AST::Expression> UnverifyMem(AST::Owned<AST::Expression> V) {
 
-		if(Parser::all_parser_mems.find(V->name) != Parser::all_parser_mems.end()) {
+		if(Parser::all_parser_mems.count(V->name)) {
 	
-			std::string getMemName = V->name;
+			Symbol getMemName = V->name;
 	
 			auto result = MemTreatment(std::move(V), true);
 	
@@ -715,184 +995,443 @@ struct Parser {
 		return V;
 	}
 
-	static std::unique_ptr<AST::Expression> ParseAddOperator(std::unique_ptr<AST::Expression> L) {
+	static AST::Owned<AST::Expression> ParseAddOperator(AST::Owned<AST::Expression> L) {
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		if(Lexer::CurrentToken != '=') {
+		if(CurrentToken() != '=') {
 			ExprError("Expected '='.");
 		}
 
-		Lexer::GetNextToken();
+		NextToken();
 
 		auto R = ParseExpression();
 
-		return std::make_unique<AST::Add>(UnverifyMem(std::move(L)), MemTreatment(std::move(R)));
+		CheckStoredType(L->name, R.get());
+
+		return AST::New<AST::Add>(UnverifyMem(std::move(L)), MemTreatment(std::move(R)));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseSubOperator(std::unique_ptr<AST::Expression> L) {
+	static AST::Owned<AST::Expression> ParseSubOperator(AST::Owned<AST::Expression> L) {
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		if(Lexer::CurrentToken != '=') {
+		if(CurrentToken() != '=') {
 			ExprError("Expected '='.");
 		}
 
-		Lexer::GetNextToken();
+		NextToken();
 
 		auto R = ParseExpression();
 
-		return std::make_unique<AST::Sub>(UnverifyMem(std::move(L)), MemTreatment(std::move(R)));
+		CheckStoredType(L->name, R.get());
+
+		return AST::New<AST::Sub>(UnverifyMem(std::move(L)), MemTreatment(std::move(R)));
 	}
 
-	static std::unique_ptr<AST::Expression> ParseEqualsOperator(std::unique_ptr<AST::Expression> L) {
+	static AST::Owned<AST::Expression> ParseEqualsOperator(AST::Owned<AST::Expression> L) {
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		if(all_parser_coms.find(L->name) != all_parser_coms.end()) {
+		if(all_parser_coms.count(L->name)) {
 
 			auto R = ParseExpression();
 
-			return std::make_unique<AST::ComStore>(std::move(L), MemTreatment(std::move(R)));
+			CheckStoredType(L->name, R.get());
+
+			return AST::New<AST::ComStore>(std::move(L), MemTreatment(std::move(R)));
 		}
 
-		if(all_parser_mems.find(L->name) != all_parser_mems.end()) {
+		if(all_parser_mems.count(L->name)) {
 
 			auto R = ParseExpression();
 
-			return std::make_unique<AST::MemStore>(std::move(L), MemTreatment(std::move(R)));
+			CheckStoredType(L->name, R.get());
+
+			auto store = AST::New<AST::MemStore>(std::move(L), MemTreatment(std::move(R)));
+
+			// The mem holds the new value now, the next read loads it again.
+			Parser_Mem* pMem = all_parser_mems[store->name].get();
+
+			pMem->loadVariable = Symbols::None;
+			pMem->is_verified = true;
+
+			return store;
 		}
 
 		ExprError("Unknown var type found.");
 		return nullptr;
 	}
 
-	static std::unique_ptr<AST::Expression> ParseBinaryOperator(std::unique_ptr<AST::Expression> L) {
+	static AST::Owned<AST::Expression> ParseBinaryOperator(AST::Owned<AST::Expression> L) {
 
-		if(Lexer::CurrentToken == '=') {
+		if(CurrentToken() == '=') {
 			return ParseEqualsOperator(std::move(L));
 		}
-		else if(Lexer::CurrentToken == '+') {
+		else if(CurrentToken() == '+') {
 			return ParseAddOperator(std::move(L));
 		}
-		else if(Lexer::CurrentToken == '-') {
+		else if(CurrentToken() == '-') {
 			return ParseSubOperator(std::move(L));
 		}
 
 		return L;
 	}
 
-	static std::unique_ptr<AST::Expression> ParseExpression() {
+	// Operators are lexed one character at a time. A two character one is
+	// two tokens with nothing in between.
+	static bool JoinedWithNext() {
+
+		size_t next = token_index + 1;
+
+		if(next >= source->Tokens.Size()) {
+			return false;
+		}
+
+		return source->Tokens.Offsets[next] == source->Tokens.Offsets[token_index] + 1;
+	}
+
+	// Lowest to highest: | ^ & (== !=) (< > <= >=) (<< >>) (+ -) (* / %).
+	// A lone '=', '+=' and '-=' aren't operators, they end the expression.
+	static Parser_Operator CurrentOperator() {
+
+		int next = JoinedWithNext() ? PeekToken() : 0;
+
+		switch(CurrentToken()) {
+
+			case '|': return { 1, AST::BinaryType::BitOr };
+			case '^': return { 2, AST::BinaryType::BitXor };
+			case '&': return { 3, AST::BinaryType::BitAnd };
+
+			case '=':
+				if(next == '=') return { 4, AST::CompareType::IsEquals, true, 2 };
+				break;
+
+			case '!':
+				if(next == '=') return { 4, AST::CompareType::IsNotEquals, true, 2 };
+				break;
+
+			case '<':
+				if(next == '<') return { 6, AST::BinaryType::ShiftLeft, false, 2 };
+				if(next == '=') return { 5, AST::CompareType::IsLessThanOrEquals, true, 2 };
+				return { 5, AST::CompareType::IsLessThan, true };
+
+			case '>':
+				if(next == '>') return { 6, AST::BinaryType::ShiftRight, false, 2 };
+				if(next == '=') return { 5, AST::CompareType::IsMoreThanOrEquals, true, 2 };
+				return { 5, AST::CompareType::IsMoreThan, true };
+
+			case '+':
+				if(next != '=') return { 7, AST::BinaryType::Plus };
+				break;
+
+			case '-':
+				if(next != '=') return { 7, AST::BinaryType::Minus };
+				break;
+
+			case '*': return { 8, AST::BinaryType::Times };
+			case '/': return { 8, AST::BinaryType::Divide };
+			case '%': return { 8, AST::BinaryType::Remainder };
+		}
+
+		return {};
+	}
+
+	// Computes an operator on two literals while parsing. Both are fitted to
+	// the statement's type first, so the result is the one codegen would give
+	// at that width: '/', '%' and '>>' are signed, comparisons are unsigned
+	// like COMPARE and give an i1. A comparison assigned to an i1 compares
+	// at i32, as literals do when nothing gives them a type.
+	static AST::Owned<AST::Expression> FoldOperator(const Parser_Operator& op, AST::IntNumber* a, AST::IntNumber* b) {
+
+		AST::Owned<AST::Type> target = TargetType();
+
+		if(op.compare && llvm::isa<AST::Integer1>(target.get())) {
+			target = AST::New<AST::Integer32>();
+		}
+
+		FitLiteral(a, target.get());
+		FitLiteral(b, target.get());
+
+		if(a->num.getBitWidth() != b->num.getBitWidth()) {
+			ExprError("Both sides of an operator need the same type, found " + a->ty->ToLLMascal().str() + " and " + b->ty->ToLLMascal().str() + ". Use a cast.");
+		}
+
+		const llvm::APInt& x = a->num;
+		const llvm::APInt& y = b->num;
+
+		if(op.compare) {
+
+			bool r = false;
+
+			if(op.kind == AST::CompareType::IsLessThan) { r = x.ult(y); }
+			else if(op.kind == AST::CompareType::IsMoreThan) { r = x.ugt(y); }
+			else if(op.kind == AST::CompareType::IsEquals) { r = x == y; }
+			else if(op.kind == AST::CompareType::IsNotEquals) { r = x != y; }
+			else if(op.kind == AST::CompareType::IsLessThanOrEquals) { r = x.ule(y); }
+			else if(op.kind == AST::CompareType::IsMoreThanOrEquals) { r = x.uge(y); }
+
+			return AST::New<AST::IntNumber>(llvm::APInt(1, r), AST::New<AST::Integer1>());
+		}
+
+		if((op.kind == AST::BinaryType::Divide || op.kind == AST::BinaryType::Remainder) && y.isZero()) {
+			ExprError("Division by zero.");
+		}
+
+		llvm::APInt r;
+
+		if(op.kind == AST::BinaryType::Plus) { r = x + y; }
+		else if(op.kind == AST::BinaryType::Minus) { r = x - y; }
+		else if(op.kind == AST::BinaryType::Times) { r = x * y; }
+		else if(op.kind == AST::BinaryType::Divide) { r = x.sdiv(y); }
+		else if(op.kind == AST::BinaryType::Remainder) { r = x.srem(y); }
+		else if(op.kind == AST::BinaryType::ShiftLeft) { r = x.shl(y); }
+		else if(op.kind == AST::BinaryType::ShiftRight) { r = x.ashr(y); }
+		else if(op.kind == AST::BinaryType::BitAnd) { r = x & y; }
+		else if(op.kind == AST::BinaryType::BitOr) { r = x | y; }
+		else { r = x ^ y; }
+
+		return AST::New<AST::IntNumber>(std::move(r), a->ty->Clone());
+	}
+
+	// Type of an operand as far as the parser knows it, nullptr when it doesn't.
+	static AST::Type* OperandType(AST::Expression* e) {
+
+		if(auto cast = llvm::dyn_cast<AST::IntCast>(e)) {
+			return cast->intType.get();
+		}
+
+		if(e->ty) {
+			return e->ty.get();
+		}
+
+		if(llvm::isa<AST::Variable>(e)) {
+			return LookupType(e->name);
+		}
+
+		return nullptr;
+	}
+
+	// A com or mem keeps the type it's declared with. Nothing converts what's
+	// put in it, so a value of another width is an error.
+	static void CheckStoredType(Symbol name, AST::Expression* value) {
+
+		AST::Type* declared = LookupType(name);
+		AST::Type* value_type = OperandType(value);
+
+		if(declared != nullptr && value_type != nullptr && declared->BitWidth() != value_type->BitWidth()) {
+			ExprError("'" + std::string(Symbols::Name(name)) + "' is declared " + declared->ToLLMascal().str() + " but given " + value_type->ToLLMascal().str() + ". Use a cast.");
+		}
+	}
+
+	// Both sides of an operator have one type. A literal takes the type of
+	// the other side, so 'a < 5' compares at the width of 'a' whatever the
+	// statement assigns to, and the result of '<' is an i1.
+	static AST::Owned<AST::Expression> MakeOperator(const Parser_Operator& op, AST::Owned<AST::Expression> L, AST::Owned<AST::Expression> R) {
+
+		auto a = llvm::dyn_cast<AST::IntNumber>(L.get());
+		auto b = llvm::dyn_cast<AST::IntNumber>(R.get());
+
+		if(a != nullptr && b != nullptr) {
+			return FoldOperator(op, a, b);
+		}
+
+		// Looked up before MemTreatment renames a mem to its loaded com.
+		AST::Type* left_type = OperandType(L.get());
+		AST::Type* right_type = OperandType(R.get());
+
+		if(a != nullptr) {
+			FitLiteral(a, right_type != nullptr ? right_type : TargetType().get());
+			left_type = a->ty.get();
+		}
+
+		if(b != nullptr) {
+			FitLiteral(b, left_type != nullptr ? left_type : TargetType().get());
+			right_type = b->ty.get();
+		}
+
+		if(left_type != nullptr && right_type != nullptr && left_type->BitWidth() != right_type->BitWidth()) {
+			ExprError("Both sides of an operator need the same type, found " + left_type->ToLLMascal().str() + " and " + right_type->ToLLMascal().str() + ". Use a cast.");
+		}
+
+		AST::Type* operand_type = left_type != nullptr ? left_type : right_type;
+
+		L = MemTreatment(std::move(L));
+		R = MemTreatment(std::move(R));
+
+		if(op.compare) {
+
+			auto compare = AST::New<AST::Compare>(std::move(L), std::move(R), op.kind);
+			compare->ty = AST::New<AST::Integer1>();
+
+			return compare;
+		}
+
+		auto binary = AST::New<AST::Binary>(std::move(L), std::move(R), op.kind);
+
+		if(operand_type != nullptr) {
+			binary->ty = CopyType(operand_type);
+		}
+
+		return binary;
+	}
+
+	// Precedence climbing. Takes operators binding at least as tight as
+	// 'min_precedence', each one left associative.
+	static AST::Owned<AST::Expression> ParseOperators(AST::Owned<AST::Expression> L, int min_precedence) {
+
+		while(true) {
+
+			Parser_Operator op = CurrentOperator();
+
+			if(op.precedence == 0 || op.precedence < min_precedence) {
+				return L;
+			}
+
+			for(int i = 0; i < op.length; i++) {
+				NextToken();
+			}
+
+			auto R = ParseOperators(ParsePrimary(), op.precedence + 1);
+
+			L = MakeOperator(op, std::move(L), std::move(R));
+		}
+	}
+
+	static AST::Owned<AST::Expression> ParseParenthesized() {
+
+		NextToken();
+
+		auto e = ParseOperators(ParsePrimary(), 1);
+
+		if(CurrentToken() != ')') { ExprError("Expected ')'."); }
+
+		NextToken();
+
+		return e;
+	}
+
+	static AST::Owned<AST::Expression> ParseExpression() {
 
-		auto P = ParsePrimary();
+		size_t start = token_index;
+
+		auto P = ParseOperators(ParsePrimary(), 1);
+
+		if(auto n = llvm::dyn_cast<AST::IntNumber>(P.get())) {
+
+			// A literal that doesn't fit is reported where it starts.
+			size_t end = token_index;
+
+			token_index = start;
+			FitLiteral(n, TargetType().get());
+			token_index = end;
+		}
 
 		return ParseBinaryOperator(std::move(P));
 	}
 
 	static AST::Attributes ParseAttributes() {
 
-		Lexer::GetNextToken();
+		NextToken();
 
 		AST::Attributes attrs;
 
-		while(Lexer::CurrentToken != ']') {
+		while(CurrentToken() != ']') {
 
-			if(Lexer::IsIdentifier("StackProtected")) {
+			if(TokenText() == "StackProtected") {
 				attrs.isStackProtected = true;
 			}
 
-			Lexer::GetNextToken();
+			NextToken();
 
-			if(Lexer::CurrentToken == ']') {
+			if(CurrentToken() == ']') {
 				break;
 			}
-			else if(Lexer::CurrentToken != ',') {
+			else if(CurrentToken() != ',') {
 				ExprError("Expected ',' to split attributes or ']' to close them.");
 			}
 
-			Lexer::GetNextToken();
+			NextToken();
 		}
 
-		if(Lexer::CurrentToken == ']') {
-			Lexer::GetNextToken();
+		if(CurrentToken() == ']') {
+			NextToken();
 		}
 
 		return attrs;
 	}
 
-	static std::unique_ptr<AST::Program> ParseProgram() {
+	static AST::Owned<AST::Program> ParseProgram() {
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		if(Lexer::CurrentToken == '[') {
+		if(CurrentToken() == '[') {
 			Parser::currentAttributes = ParseAttributes();
 		}
 
-		if(Lexer::CurrentToken != Token::Begin) { ExprError("'begin' keyword not found."); }
+		if(CurrentToken() != Token::Begin) { ExprError("'begin' keyword not found."); }
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		std::vector<std::unique_ptr<AST::Expression>> all_instructions;
+		AST::Vector<AST::Owned<AST::Expression>> all_instructions;
 
-		while (Lexer::CurrentToken != Token::End) { 
+		while (CurrentToken() != Token::End) { 
 
-			std::unique_ptr<AST::Expression> e = ParseExpression();
+			AST::Owned<AST::Expression> e = ParseExpression();
 
-			if(Lexer::CurrentToken != ';') { ExprError("Expected ';' to end instruction inside program."); }
+			if(CurrentToken() != ';') { ExprError("Expected ';' to end instruction inside program."); }
 
 			all_instructions.push_back(std::move(e));
 
 			ResetMainTarget();
 
-			Lexer::GetNextToken();
+			NextToken();
 		}
 
-		return std::make_unique<AST::Program>(std::move(all_instructions), Parser::currentAttributes);
+		return AST::New<AST::Program>(std::move(all_instructions), Parser::currentAttributes);
 	}
 
-	static std::unique_ptr<AST::Procedure> ParseProcedure() {
+	// Reads 'proc name(args): type' and indexes the procedure, leaving the
+	// current token on its 'begin'.
+	static AST::Owned<AST::Procedure> ParseProcedureSignature() {
 
-		Lexer::isInside = LexerIsInside::AProcedure;
+		NextToken();
 
-		Lexer::GetNextToken();
+		Symbol procName = TokenSymbol();
 
-		std::string procName = Lexer::IdentifierStr;
-
-		Parser::current_procedure_name = procName;
-
-		Lexer::GetNextToken();
+		if(procedure_index.count(procName)) {
+			ExprError("Procedure '" + std::string(Symbols::Name(procName)) + "' is already defined.");
+		}
 
-		std::vector<std::string> all_argument_var_types;
-		std::vector<std::unique_ptr<AST::Expression>> all_arguments;
-		std::vector<std::unique_ptr<AST::Type>> all_argument_types;
-		std::vector<std::unique_ptr<AST::Expression>> body;
+		NextToken();
 
-		if(Lexer::CurrentToken != '(') { ExprError("Expected '(' to add arguments."); }
+		AST::Vector<AST::Owned<AST::Expression>> all_arguments;
+		AST::Vector<AST::Owned<AST::Type>> all_argument_types;
 
-		Lexer::GetNextToken();
+		if(CurrentToken() != '(') { ExprError("Expected '(' to add arguments."); }
 
-		while(Lexer::CurrentToken != ')') {
+		NextToken();
 
-			if(Lexer::CurrentToken == Token::Com)
-				all_argument_var_types.push_back("com");
+		while(CurrentToken() != ')') {
 
-			Lexer::GetNextToken();
+			// Steps over 'com'.
+			NextToken();
 
 			auto I = ParseIdentifier();
 
-			if(Lexer::CurrentToken != ':') { ExprError("Expected ':' to specify argument type."); }
+			if(CurrentToken() != ':') { ExprError("Expected ':' to specify argument type."); }
 
-			Lexer::GetNextToken();
+			NextToken();
 
 			auto T = IdentStrToType();
 
-			Lexer::GetNextToken();
+			NextToken();
 
 			all_arguments.push_back(std::move(I));
 			all_argument_types.push_back(std::move(T));
 
-			if(Lexer::CurrentToken != ',') {
-				if(Lexer::CurrentToken == ')') {
+			if(CurrentToken() != ',') {
+				if(CurrentToken() == ')') {
 					break;
 				}
 				else {
@@ -900,109 +1439,260 @@ struct Parser {
 				}
 			}
 
-			Lexer::GetNextToken();
+			NextToken();
 		}
 
-		if(Lexer::CurrentToken != ')') { ExprError("Expected ')' to close argument list."); }
+		if(CurrentToken() != ')') { ExprError("Expected ')' to close argument list."); }
 
-		Lexer::GetNextToken();
+		NextToken();
 
-		std::unique_ptr<AST::Type> procType;
+		AST::Owned<AST::Type> procType;
 
-		if(Lexer::CurrentToken == ':') { 
+		if(CurrentToken() == ':') { 
 
-			Lexer::GetNextToken();
+			NextToken();
 
 			procType = IdentStrToType();
 
-			Lexer::GetNextToken();
+			NextToken();
 		}
-		else if(Lexer::CurrentToken != Token::Begin) {
+		else if(CurrentToken() != Token::Begin) {
 			ExprError("Expected ':' to specify procedure type or 'begin' in procedure.");
 		}
 
-		bool isVoid = false;
-
 		if(procType == nullptr) {
-			isVoid = true;
-			procType = std::make_unique<AST::Void>();
+			procType = AST::New<AST::Void>();
 		}
 
-		auto proc = std::make_unique<AST::Procedure>(procName, all_argument_var_types, std::move(all_arguments), std::move(all_argument_types), std::move(procType));
+		auto newProc = AST::New<AST::Procedure>(procName, std::move(all_arguments), std::move(all_argument_types), std::move(procType));
 
-		all_procedures.push_back(std::move(proc));
+		// Indexed before any body is parsed, so procedures can call themselves
+		// and each other in any order.
+		procedure_index[procName].proc = newProc.get();
+
+		if(CurrentToken() != Token::Begin) { ExprError("Expected 'begin' in procedure."); }
+
+		return newProc;
+	}
+
+	// Moves from a procedure's 'begin' to its closing 'end' without building
+	// anything. 'if' and 'while' open blocks closed by 'end', an 'if' right
+	// after 'else' continues the block it's in.
+	static void SkipProcedureBody() {
 
-		auto newProc = all_procedures[all_procedures.size() - 1]->CloneWithoutBody();
+		int depth = 0;
+		int previous = 0;
 
-		//std::cout << "Clone Success!\n";
+		do {
 
-		if(Lexer::CurrentToken != Token::Begin) { ExprError("Expected 'begin' in procedure."); }
+			int tok = CurrentToken();
 
-		Lexer::GetNextToken();
+			if(tok == Token::Begin || tok == Token::While || (tok == Token::If && previous != Token::Else)) {
+				depth++;
+			}
+			else if(tok == Token::End) {
+				depth--;
+			}
+			else if(tok == Token::EndOfFile) {
+				ExprError("Expected 'end' to close procedure.");
+			}
 
-		if(!isVoid) {
+			previous = tok;
 
-			auto return_value = std::make_unique<AST::Com>(procName + "_return", newProc->proc_type->Clone(), std::make_unique<AST::IntNumber>(0, newProc->proc_type->Clone()));
+			if(depth > 0) {
+				NextToken();
+			}
+
+		} while(depth > 0);
+	}
+
+	// Parses the body of an indexed procedure, from its 'begin' up to the
+	// matching 'end'. Touches only the procedure and thread local state.
+	static void ParseProcedureBody(AST::Procedure* proc) {
+
+		Parser::isInside = LexerIsInside::AProcedure;
+		Parser::current_procedure_name = proc->procName;
+
+		ResetScope();
+
+		for(size_t i = 0; i < proc->all_arguments.size(); i++) {
+			current_argument_types[proc->all_arguments[i]->name] = proc->all_argument_types[i].get();
+		}
 
-			AddParserCom(procName + "_return", return_value->ty.get());
+		NextToken();
+
+		AST::Vector<AST::Owned<AST::Expression>> body;
+
+		if(proc->proc_type->BitWidth() != 0) {
+
+			auto return_value = AST::New<AST::Com>(Suffixed(proc->procName, "_return"), proc->proc_type->Clone(), AST::New<AST::IntNumber>(0, proc->proc_type->Clone()));
+
+			AddParserCom(return_value->name, return_value->ty.get());
+
+			proc->returnName = return_value->name;
 
 			body.push_back(std::move(return_value));
 		}
 
-		while (Lexer::CurrentToken != Token::End) { 
+		while (CurrentToken() != Token::End) { 
 
-			std::unique_ptr<AST::Expression> e = ParseExpression();
+			AST::Owned<AST::Expression> e = ParseExpression();
 
-			if(Lexer::CurrentToken != ';') { ExprError("Expected ';' to end instruction inside procedure."); }
+			if(CurrentToken() != ';') { ExprError("Expected ';' to end instruction inside procedure."); }
 
 			body.push_back(std::move(e));
 
 			ResetMainTarget();
 
-			Lexer::GetNextToken();
+			NextToken();
 		}
 
-		newProc->body = std::move(body);
+		proc->body = std::move(body);
+	}
 
-		all_procedures.pop_back();
+	// Every node writes itself into the one buffered stream.
+	static void WriteLLMascal(AST::Program* program) {
 
-		return newProc;
+		std::error_code error;
+		llvm::raw_fd_ostream myfile("llm_main.mascal", error);
+
+		if(error) {
+			std::cout << "Could not write llm_main.mascal: " << error.message() << "\n";
+			exit(1);
+		}
+
+		for(auto const& i : all_procedures) {
+			if(i->call_count > 0) {
+				i->ToLLMascal(myfile);
+			}
+		}
+
+		program->ToLLMascal(myfile);
 	}
 
 	static void HandleProgram() {
 
-		Lexer::isInside = LexerIsInside::AProgram;
+		Parser::isInside = LexerIsInside::AProgram;
 
 		auto program = ParseProgram();
 
-		std::ofstream myfile;
-  		myfile.open("llm_main.mascal");
-  		myfile << program->ToLLMascal();
-  		myfile.close();
+		MemElision::Run(program.get());
+
+		ParseRequestedBodies();
+
+		WriteLLMascal(program.get());
+
+		// LLVM isn't thread safe, the procedures are generated one by one in
+		// source order. All are declared first, so calls can go either way.
+		for(auto const& i : all_procedures) {
+			if(i->call_count > 0) {
+				i->Declare();
+			}
+		}
+
+		for(auto const& i : all_procedures) {
+			if(i->call_count > 0) {
+				i->codegen();
+			}
+		}
 
 		program->codegen();
 
-		CodeGen::TheModule->print(llvm::outs(), nullptr);
+		CodeGen::Verify();
+
+		CodeGen::Optimize();
+
+		CodeGen::Emit();
+
+		MemElision::Report();
+
+		// Nothing reads the AST after the program is generated. No node is
+		// destroyed on its own, the tree and its child lists go with the
+		// arenas in one step.
+		program.reset();
+
+		all_procedures.clear();
+		procedure_index.clear();
+		requested_bodies.clear();
+		current_argument_types.clear();
+		all_parser_coms.clear();
+		all_parser_mems.clear();
+
+		AST::ReleaseArena();
 	}
 
+	// Reads the signature of a procedure and skips its body, only noting
+	// where it is. Every signature is known before any body is parsed.
 	static void HandleProcedure() {
 
-		auto proc = ParseProcedure();
+		auto proc = ParseProcedureSignature();
+
+		Parser_Procedure& entry = procedure_index[proc->procName];
+
+		entry.source = source;
+		entry.begin = token_index;
+
+		SkipProcedureBody();
+
+		entry.end = token_index;
+
+		// The arguments were parsed as identifiers, none of them is a target.
+		ResetMainTarget();
 
 		all_procedures.push_back(std::move(proc));
 	}
 
+	// Parses the bodies calls asked for, side by side, each from its own
+	// position in the tokens. They can call procedures of their own, so it
+	// goes on in rounds until no new body is asked for.
+	static void ParseRequestedBodies() {
+
+		Lexer* lexer = source;
+		size_t position = token_index;
+
+		while(true) {
+
+			std::vector<Symbol> round;
+
+			{
+				std::lock_guard<std::mutex> guard(requested_lock);
+				std::swap(round, requested_bodies);
+			}
+
+			if(round.empty()) {
+				break;
+			}
+
+			ThreadPool::ForEach(round.size(), [&](size_t i) {
+
+				const Parser_Procedure& entry = procedure_index.find(round[i])->second;
+
+				SetSource(entry.source);
+				token_index = entry.begin;
+
+				ParseProcedureBody(entry.proc);
+
+				if(token_index != entry.end) { ExprError("Expected 'end' to close procedure."); }
+
+				MemElision::Run(entry.proc);
+			});
+		}
+
+		// Back where the caller was. Bodies may have run on this thread too.
+		SetSource(lexer);
+		token_index = position;
+	}
+
 	static void MainLoop() {
 
 		StartMainTargetSystem();
 
-		while (Lexer::CurrentToken != Token::EndOfFile) {
+		while (CurrentToken() != Token::EndOfFile) {
 
-			Lexer::GetNextToken();
+			if (CurrentToken() == Token::Program) 		HandleProgram();
+			if (CurrentToken() == Token::Procedure) 	HandleProcedure();
 
-			if (Lexer::CurrentToken == Token::EndOfFile) 	break;
-			if (Lexer::CurrentToken == Token::Program) 		HandleProgram();
-			if (Lexer::CurrentToken == Token::Procedure) 	HandleProcedure();
+			NextToken();
 		}
 	}
 };
@@ -0,0 +1,196 @@
+#ifndef SCANNER_HPP
+#define SCANNER_HPP
+
+#include <string_view>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Finds the end of character runs (whitespace, comments, identifiers, numbers)
+// for the Lexer. Each class is tested on 32 bytes at a time with AVX2, 16 with
+// SSE2, and a byte at a time for the tail or when neither is available.
+// Build with -mavx2 (or -march=native) to get the 32 byte path.
+struct Scanner
+{
+#if defined(__SSE2__)
+	// Unsigned 'lo <= c <= hi' for every byte.
+	static __m128i InRange16(__m128i c, uint8_t lo, uint8_t hi)
+	{
+		__m128i t = _mm_sub_epi8(c, _mm_set1_epi8((char)lo));
+		return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8((char)(hi - lo))), t);
+	}
+
+	static __m128i Equals16(__m128i c, char x)
+	{
+		return _mm_cmpeq_epi8(c, _mm_set1_epi8(x));
+	}
+#endif
+
+#if defined(__AVX2__)
+	static __m256i InRange32(__m256i c, uint8_t lo, uint8_t hi)
+	{
+		__m256i t = _mm256_sub_epi8(c, _mm256_set1_epi8((char)lo));
+		return _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8((char)(hi - lo))), t);
+	}
+
+	static __m256i Equals32(__m256i c, char x)
+	{
+		return _mm256_cmpeq_epi8(c, _mm256_set1_epi8(x));
+	}
+#endif
+
+	// ' ', '\t', '\n', '\v', '\f', '\r', the same set as isspace in the C locale.
+	struct Whitespace
+	{
+		static bool Match(uint8_t c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+#if defined(__SSE2__)
+		static __m128i Match16(__m128i c) { return _mm_or_si128(Equals16(c, ' '), InRange16(c, '\t', '\r')); }
+#endif
+#if defined(__AVX2__)
+		static __m256i Match32(__m256i c) { return _mm256_or_si256(Equals32(c, ' '), InRange32(c, '\t', '\r')); }
+#endif
+	};
+
+	// Anything but a line break, used to run to the end of a '#' comment.
+	struct CommentBody
+	{
+		static bool Match(uint8_t c) { return c != '\n' && c != '\r'; }
+
+#if defined(__SSE2__)
+		static __m128i Match16(__m128i c)
+		{
+			__m128i lineEnd = _mm_or_si128(Equals16(c, '\n'), Equals16(c, '\r'));
+			return _mm_xor_si128(lineEnd, _mm_set1_epi8(-1));
+		}
+#endif
+#if defined(__AVX2__)
+		static __m256i Match32(__m256i c)
+		{
+			__m256i lineEnd = _mm256_or_si256(Equals32(c, '\n'), Equals32(c, '\r'));
+			return _mm256_xor_si256(lineEnd, _mm256_set1_epi8(-1));
+		}
+#endif
+	};
+
+	// [A-Za-z0-9_], the characters Lexer::is_still_identifier accepts.
+	struct IdentifierBody
+	{
+		static bool Match(uint8_t c)
+		{
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+		}
+
+#if defined(__SSE2__)
+		static __m128i Match16(__m128i c)
+		{
+			__m128i alpha = InRange16(_mm_or_si128(c, _mm_set1_epi8(0x20)), 'a', 'z');
+			__m128i digit = InRange16(c, '0', '9');
+			return _mm_or_si128(_mm_or_si128(alpha, digit), Equals16(c, '_'));
+		}
+#endif
+#if defined(__AVX2__)
+		static __m256i Match32(__m256i c)
+		{
+			__m256i alpha = InRange32(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), 'a', 'z');
+			__m256i digit = InRange32(c, '0', '9');
+			return _mm256_or_si256(_mm256_or_si256(alpha, digit), Equals32(c, '_'));
+		}
+#endif
+	};
+
+	// Digits plus '.', 'f' and '_', the characters Lexer::GetNumber accepts.
+	struct NumberBody
+	{
+		static bool Match(uint8_t c) { return (c >= '0' && c <= '9') || c == '.' || c == 'f' || c == '_'; }
+
+#if defined(__SSE2__)
+		static __m128i Match16(__m128i c)
+		{
+			__m128i digit = InRange16(c, '0', '9');
+			__m128i extra = _mm_or_si128(_mm_or_si128(Equals16(c, '.'), Equals16(c, 'f')), Equals16(c, '_'));
+			return _mm_or_si128(digit, extra);
+		}
+#endif
+#if defined(__AVX2__)
+		static __m256i Match32(__m256i c)
+		{
+			__m256i digit = InRange32(c, '0', '9');
+			__m256i extra = _mm256_or_si256(_mm256_or_si256(Equals32(c, '.'), Equals32(c, 'f')), Equals32(c, '_'));
+			return _mm256_or_si256(digit, extra);
+		}
+#endif
+	};
+
+	// Hex digits and '_', the body of '0x' and '0b' literals.
+	struct HexNumberBody
+	{
+		static bool Match(uint8_t c)
+		{
+			return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') || c == '_';
+		}
+
+#if defined(__SSE2__)
+		static __m128i Match16(__m128i c)
+		{
+			__m128i hex = InRange16(_mm_or_si128(c, _mm_set1_epi8(0x20)), 'a', 'f');
+			return _mm_or_si128(_mm_or_si128(InRange16(c, '0', '9'), hex), Equals16(c, '_'));
+		}
+#endif
+#if defined(__AVX2__)
+		static __m256i Match32(__m256i c)
+		{
+			__m256i hex = InRange32(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), 'a', 'f');
+			return _mm256_or_si256(_mm256_or_si256(InRange32(c, '0', '9'), hex), Equals32(c, '_'));
+		}
+#endif
+	};
+
+	// Offset of the first byte at or after 'from' that isn't in Class,
+	// or s.size() if the run goes to the end.
+	template<typename Class>
+	static size_t Skip(std::string_view s, size_t from)
+	{
+		const char* data = s.data();
+		size_t size = s.size();
+		size_t i = from;
+
+#if defined(__AVX2__)
+		while (i + 32 <= size)
+		{
+			__m256i chunk = _mm256_loadu_si256((const __m256i*)(data + i));
+			uint32_t mask = (uint32_t)_mm256_movemask_epi8(Class::Match32(chunk));
+
+			if (mask != 0xFFFFFFFFu) return i + __builtin_ctz(~mask);
+
+			i += 32;
+		}
+#endif
+
+#if defined(__SSE2__)
+		while (i + 16 <= size)
+		{
+			__m128i chunk = _mm_loadu_si128((const __m128i*)(data + i));
+			uint32_t mask = (uint32_t)_mm_movemask_epi8(Class::Match16(chunk));
+
+			if (mask != 0xFFFFu) return i + __builtin_ctz(~mask & 0xFFFFu);
+
+			i += 16;
+		}
+#endif
+
+		while (i < size && Class::Match((uint8_t)data[i])) i++;
+
+		return i;
+	}
+
+	static size_t SkipWhitespace(std::string_view s, size_t from) { return Skip<Whitespace>(s, from); }
+	static size_t SkipComment(std::string_view s, size_t from) { return Skip<CommentBody>(s, from); }
+	static size_t SkipIdentifier(std::string_view s, size_t from) { return Skip<IdentifierBody>(s, from); }
+	static size_t SkipNumber(std::string_view s, size_t from) { return Skip<NumberBody>(s, from); }
+	static size_t SkipHexNumber(std::string_view s, size_t from) { return Skip<HexNumberBody>(s, from); }
+};
+
+#endif
@@ -0,0 +1,5 @@
+#include "Symbols.hpp"
+
+llvm::StringMap<Symbol> Symbols::table;
+std::deque<std::string_view> Symbols::names = { std::string_view() };
+std::mutex Symbols::lock;
@@ -0,0 +1,58 @@
+#ifndef SYMBOLS_HPP
+#define SYMBOLS_HPP
+
+#include <string_view>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include "llvm/ADT/StringMap.h"
+
+typedef uint32_t Symbol;
+
+// Process wide string interner. Equal names get equal ids, so after lexing
+// a name is compared and hashed as a 32-bit integer.
+// Lexers running on different threads intern into the same table.
+struct Symbols {
+
+	// The empty name. Id 0 is never handed out for anything else, so None
+	// can be looked up in any table keyed by symbol and simply isn't found.
+	static constexpr Symbol None = 0;
+
+	static llvm::StringMap<Symbol> table;
+	static std::deque<std::string_view> names;
+	static std::mutex lock;
+
+	static Symbol Intern(std::string_view name) {
+
+		if(name.empty()) return None;
+
+		std::lock_guard<std::mutex> guard(lock);
+
+		auto inserted = table.try_emplace(llvm::StringRef(name.data(), name.size()), (Symbol)names.size());
+
+		if(inserted.second) {
+			// StringMap owns the key bytes, so the view stays valid.
+			names.push_back(std::string_view(inserted.first->getKeyData(), name.size()));
+		}
+
+		return inserted.first->second;
+	}
+
+	static std::string_view Name(Symbol s) {
+
+		if(s == None) return {};
+
+		std::lock_guard<std::mutex> guard(lock);
+
+		return names[s];
+	}
+
+	static size_t Count() {
+
+		std::lock_guard<std::mutex> guard(lock);
+
+		return names.size();
+	}
+};
+
+#endif
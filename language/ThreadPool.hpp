@@ -0,0 +1,49 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <functional>
+
+struct ThreadPool {
+
+	static unsigned WorkerCount(size_t jobs) {
+
+		unsigned hw = std::thread::hardware_concurrency();
+
+		if(hw == 0) hw = 1;
+
+		return jobs < hw ? (unsigned)jobs : hw;
+	}
+
+	// Runs job(0) .. job(count - 1) spread over the available cores and
+	// returns once all of them finished. Jobs are handed out one at a time,
+	// so uneven sizes still balance.
+	static void ForEach(size_t count, const std::function<void(size_t)>& job) {
+
+		unsigned workers = WorkerCount(count);
+
+		if(workers <= 1) {
+
+			for(size_t i = 0; i < count; i++) job(i);
+			return;
+		}
+
+		std::atomic<size_t> next = 0;
+		std::vector<std::thread> threads;
+
+		for(unsigned w = 0; w < workers; w++) {
+
+			threads.emplace_back([&]() {
+
+				size_t i;
+				while((i = next.fetch_add(1)) < count) job(i);
+			});
+		}
+
+		for(auto& t : threads) t.join();
+	}
+};
+
+#endif
@@ -2,38 +2,112 @@
 #include "language/Lexer.hpp"
 #include "language/Parser.hpp"
 #include "language/CodeGen.hpp"
+#include "language/ThreadPool.hpp"
 
 #include "translators/Assembly/AssemblyMain.hpp"
 
 int main(int argc, char const *argv[])
 {
-	CodeGen::releaseMode = false;
-
 	if(argc > 1) {
 
 		std::string cmd = argv[1];
 
-		if(cmd == "build") {
+		// 'run' takes what 'build' does, but compiles the program in this
+		// process and runs it. Its main's return value is the exit code.
+		if(cmd == "build" || cmd == "run") {
+
+			std::vector<std::string> sources;
+
+			// "-" reads the source from stdin. "-O0" to "-O3", "-Os" and
+			// "-Oz" pick the optimization level. "--stats" reports what the mem
+			// elision pass removed and how long optimizing took. "--emit=obj"
+			// and "--emit=exe" write an object file or an executable, named
+			// after the first source unless "-o" says otherwise.
+			for(int i = 2; i < argc; i++) {
+
+				std::string arg = argv[i];
+
+				if(arg == "--stats") {
+					MemElision::report = true;
+					CodeGen::report = true;
+				}
+				else if(arg.rfind("--emit=", 0) == 0) {
+
+					CodeGen::emit = arg.substr(7);
+
+					if(CodeGen::emit != "ir" && CodeGen::emit != "obj" && CodeGen::emit != "exe") {
+						std::cout << "Error: Unknown output kind '" << CodeGen::emit << "'.\n";
+						return 1;
+					}
+				}
+				else if(arg == "-o") {
+
+					if(i + 1 >= argc) {
+						std::cout << "Error: Expected a file name after '-o'.\n";
+						return 1;
+					}
+
+					CodeGen::output = argv[++i];
+				}
+				else if(arg.size() > 1 && arg[0] == '-' && arg[1] == 'O') {
+
+					if(arg.size() != 3 || !CodeGen::SetOptimizationLevel(arg[2])) {
+						std::cout << "Error: Unknown optimization level '" << arg << "'.\n";
+						return 1;
+					}
+				}
+				else {
+					sources.push_back(arg);
+				}
+			}
+
+			if(sources.empty()) {
+				sources.push_back("main.mascal");
+			}
 
-			//if(argc < 2) {
-			//	cmd = argv[2];
+			if(cmd == "run") {
+				CodeGen::emit = "run";
+			}
 
-			//	if(cmd == "release") {
-			//		CodeGen::releaseMode = true;
-			//	}
-			//}
+			if(CodeGen::output.empty()) {
 
-			std::ifstream t("main.mascal");
-			std::string str((std::istreambuf_iterator<char>(t)),
-  			             std::istreambuf_iterator<char>());
+				std::string stem = sources[0] == "-" ? "main" : llvm::sys::path::stem(sources[0]).str();
+
+				CodeGen::output = CodeGen::emit == "obj" ? stem + ".o" : stem;
+			}
+
+			// Every source gets its own Lexer, so they are tokenized side by side.
+			std::vector<std::unique_ptr<Lexer>> lexers(sources.size());
+			std::vector<char> opened(sources.size(), 0);
+
+			ThreadPool::ForEach(sources.size(), [&](size_t i) {
+
+				lexers[i] = std::make_unique<Lexer>();
+				opened[i] = lexers[i]->OpenFile(sources[i]);
+
+				if(opened[i]) {
+					lexers[i]->Tokenize();
+				}
+			});
+
+			for(size_t i = 0; i < sources.size(); i++) {
+
+				if(!opened[i]) {
+					std::cout << "Error: Could not open '" << sources[i] << "'.\n";
+					return 1;
+				}
+			}
 		
 			CodeGen::Initialize();
+
+			// Procedures have to be known before the program that calls them,
+			// so the sources are parsed in the order they were given.
+			for(auto const& lexer : lexers) {
+
+				Parser::SetSource(lexer.get());
 		
-			Lexer::AddContent(str);
-		
-			Lexer::Start();
-		
-			Parser::MainLoop();
+				Parser::MainLoop();
+			}
 		}
 
 		if(cmd == "translate") {
@@ -42,5 +116,5 @@ int main(int argc, char const *argv[])
 		}
 	}
 
-	return 0;
+	return CodeGen::exitCode;
 }
\ No newline at end of file
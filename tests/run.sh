@@ -0,0 +1,68 @@
+#!/bin/bash
+
+# Run from the repository root after ./compile.sh: ./tests/run.sh [mascal]
+# Every test starts with '# expect: N', the exit code 'mascal run' has to
+# give, or '# expect: error' for a program that must not compile.
+# Each '# flags: ...' line runs the test once more with those arguments.
+# With --emit=exe or --emit=obj the program is built, linked if needed,
+# and the result is run instead. '# output: text' has to appear in what
+# the compiler prints.
+
+root=$(pwd)
+mascal=$(realpath "${1:-./mascal}")
+work=$(mktemp -d)
+failed=0
+
+for test in tests/*.mascal; do
+
+	expect=$(sed -n '1s/^# expect: //p' "$test")
+	want=$(sed -n 's/^# output: //p' "$test")
+
+	mapfile -t runs < <(sed -n 's/^# flags: //p' "$test")
+	[ ${#runs[@]} -eq 0 ] && runs=("")
+
+	for flags in "${runs[@]}"; do
+
+		rm -f "$work"/program "$work"/program.o
+
+		# The compiler writes llm_main.mascal where it runs, so it runs elsewhere.
+		if [ "$expect" = "error" ]; then
+			output=$(cd "$work" && "$mascal" build $flags "$root/$test" 2>&1)
+			code=$?
+			[ $code -ne 0 ] && [[ "$output" == *"Error"* ]]
+		elif [[ "$flags" == *--emit=obj* ]]; then
+			output=$(cd "$work" && "$mascal" build $flags -o program.o "$root/$test" 2>&1 && cc program.o -o program 2>&1)
+			(cd "$work" && ./program)
+			code=$?
+			[ "$code" = "$expect" ]
+		elif [[ "$flags" == *--emit=exe* ]]; then
+			output=$(cd "$work" && "$mascal" build $flags -o program "$root/$test" 2>&1)
+			(cd "$work" && ./program)
+			code=$?
+			[ "$code" = "$expect" ]
+		else
+			output=$(cd "$work" && "$mascal" run $flags "$root/$test" 2>&1)
+			code=$?
+			[ "$code" = "$expect" ]
+		fi
+
+		passed=$?
+
+		if [ $passed -eq 0 ] && [ -n "$want" ] && [[ "$output" != *"$want"* ]]; then
+			passed=1
+		fi
+
+		name="$test${flags:+ $flags}"
+
+		if [ $passed -ne 0 ]; then
+			echo "FAIL $name: expected $expect${want:+ and '$want'}, got $code"
+			[ -n "$output" ] && echo "$output" | head -5
+			failed=1
+		else
+			echo "ok   $name"
+		fi
+	done
+done
+
+rm -rf "$work"
+exit $failed
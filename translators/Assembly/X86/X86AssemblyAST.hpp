@@ -3,17 +3,29 @@
 
 #include <vector>
 #include <memory>
+#include <llvm/Support/Casting.h>
 
 #define NEW_X86_TYPE(x) struct x : public Type { std::string codegen() override; }
 
 struct X86AssemblyAST {
 
+	// Only the instructions the parser has to tell apart get a kind of their own.
+	enum ExpressionKind {
+		EK_Instruction,
+		EK_Return,
+		EK_EnableSEH
+	};
+
 	struct Expression {
 
+		const ExpressionKind kind;
+
 		std::string name;
 
 		std::string asmType;
 
+		Expression(ExpressionKind kind_in = EK_Instruction) : kind(kind_in) {}
+
 		virtual ~Expression() = default;
 
 		virtual std::string codegen() = 0;
@@ -79,7 +91,9 @@ struct X86AssemblyAST {
 
 	struct Return : public Expression {
 
-		Return() {}
+		Return() : Expression(EK_Return) {}
+
+		static bool classof(const Expression* e) { return e->kind == EK_Return; }
 
 		std::string codegen() override;
 	};
@@ -306,16 +320,14 @@ struct X86AssemblyAST {
 
 	struct EnableSEH : public Expression {
 
-		EnableSEH() {}
+		EnableSEH() : Expression(EK_EnableSEH) {}
+
+		static bool classof(const Expression* e) { return e->kind == EK_EnableSEH; }
 
 		std::string codegen() override {
 			return "";
 		}
 	};
-
-	static bool IsSEH(Expression* expr) {
-		return dynamic_cast<EnableSEH*>(expr) != nullptr;
-	}
 };
 
 #endif
\ No newline at end of file
@@ -111,14 +111,14 @@ struct X86AssemblyParser {
 
 			auto Expr = ParseExpression();
 
-			if(X86AssemblyAST::IsSEH(Expr.get())) {
+			if(llvm::isa<X86AssemblyAST::EnableSEH>(Expr.get())) {
 				attrs.isStackProtected = true;
 			}
 			else {
 				allInstructions.push_back(std::move(Expr));
 			}
 
-			if(dynamic_cast<X86AssemblyAST::Return*>(Expr.get())) {
+			if(llvm::isa_and_nonnull<X86AssemblyAST::Return>(Expr.get())) {
 				break;
 			}
 		}